@@ -0,0 +1,149 @@
+// MIT License
+//
+// Copyright (c) 2015-2024 Vector 35 Inc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef NATIVE_PREDICATE_SOLVER_BACKEND_H
+#define NATIVE_PREDICATE_SOLVER_BACKEND_H
+
+#include "scheduler.h"
+#include "stats.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+// A function as seen by a backend. The solver core only needs its start
+// address; backends downcast to their own subclass to reach the rest.
+class SolverFunction
+{
+public:
+    virtual ~SolverFunction() = default;
+    virtual uint64_t GetStart() const = 0;
+};
+
+using SolverFunctionRef = std::shared_ptr<SolverFunction>;
+
+// A branch whose condition is constant. An always-taken branch becomes an
+// unconditional jump, a never-taken one is removed.
+struct SolverPatch {
+    uint64_t address;
+    bool alwaysBranch;
+};
+
+// Shared state for scanning functions
+struct ScanContext {
+    // Pool used to split functions with at least parallelThreshold IL
+    // instructions across threads; null scans everything on the caller
+    WorkStealingPool* pool;
+    size_t parallelThreshold;
+    std::function<bool()> isCancelled;
+    // Optional run instrumentation
+    RunStats* stats;
+};
+
+enum class SolverLogLevel {
+    Info,
+    Warning
+};
+
+// Everything the solver core needs from the program being patched. The
+// plugin implements it on a BinaryView; FakeBackend implements it in memory so
+// the scheduling and commit logic can be measured without Binary Ninja.
+//
+// The scanning methods (ScanFunction, ComputeFingerprint, EstimateCost) are
+// called from many threads at once. Everything else is called from one
+// thread at a time, but possibly concurrently with scans.
+class SolverBackend
+{
+public:
+    virtual ~SolverBackend() = default;
+
+    // Every function, ordered by start address
+    virtual std::vector<SolverFunctionRef> GetFunctions() = 0;
+
+    // Functions starting at or after start, in address order, until their
+    // estimated cost reaches maxCost. Returns at least one function unless
+    // there are none left.
+    virtual std::vector<SolverFunctionRef> GetFunctionWindow(uint64_t start, uint64_t maxCost) = 0;
+
+    // Drops everything the backend keeps for the given functions between
+    // scans, such as cached IL. Called at the end of every pass over them,
+    // or of every window when streaming.
+    virtual void ReleaseFunctions(const std::vector<SolverFunctionRef>& functions) = 0;
+
+    // The current analysis of func, or null once it no longer exists
+    virtual SolverFunctionRef Refresh(const SolverFunctionRef& func) = 0;
+
+    // Scan cost of a function that has not been scanned yet, in the same unit
+    // as the instruction count ScanFunction reports
+    virtual uint64_t EstimateCost(const SolverFunctionRef& func) = 0;
+
+    // Finds the branches of func whose conditions are constant and can be
+    // patched. Nothing is written. instructionCount receives the size of the
+    // function's IL, or 0 if it has none. A backend that decides without
+    // generating IL reports an estimate instead.
+    virtual std::vector<SolverPatch> ScanFunction(const SolverFunctionRef& func, const ScanContext& ctx, size_t& instructionCount) = 0;
+
+    // Hash of the code of func. Two equal fingerprints mean a scan would find
+    // the same result.
+    virtual uint64_t ComputeFingerprint(const SolverFunctionRef& func) = 0;
+
+    // Writes patches of func. Backends may merge neighbouring patches into
+    // fewer writes, so callers pass everything they have at once. Returns the
+    // number of patches actually written.
+    virtual size_t ApplyPatches(const SolverFunctionRef& func, const std::vector<SolverPatch>& patches) = 0;
+
+    // Everything written between the two calls becomes one undoable action.
+    // Groups are never nested.
+    virtual void BeginPatchGroup() = 0;
+    virtual void EndPatchGroup() = 0;
+
+    // Functions called from func under its current analysis
+    virtual std::vector<SolverFunctionRef> GetCallees(const SolverFunctionRef& func) = 0;
+
+    // Functions whose analysis is invalidated by the given patches of func:
+    // func itself plus every function sharing one of the patched instructions
+    virtual std::vector<SolverFunctionRef> GetAffectedFunctions(const SolverFunctionRef& func, const std::vector<SolverPatch>& patches) = 0;
+
+    // Brings analysis up to date after patching and waits for it. With
+    // functionScope only the given functions are reanalysed, otherwise the
+    // whole program is. Returns early if isCancelled reports true.
+    virtual void Reanalyze(const std::vector<SolverFunctionRef>& functions, bool functionScope, const std::function<bool()>& isCancelled) = 0;
+
+    // Updates analysis of the whole program between global passes and waits
+    // for it, so the next pass sees patched code
+    virtual void UpdateAnalysis() = 0;
+
+    // Functions to revisit after the given functions were patched at the given
+    // addresses: the patched functions, their callers and callees, and every
+    // function sharing a patched instruction
+    virtual std::vector<SolverFunctionRef> GetDirtyFunctions(const std::set<uint64_t>& patchedFunctions, const std::set<uint64_t>& patchAddresses) = 0;
+
+    // Serialised verdict cache stored with the program, empty if there is none
+    virtual std::string LoadVerdicts() = 0;
+    virtual void StoreVerdicts(const std::string& verdicts) = 0;
+
+    virtual void Log(SolverLogLevel level, const std::string& message) = 0;
+};
+
+#endif //NATIVE_PREDICATE_SOLVER_BACKEND_H
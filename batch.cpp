@@ -0,0 +1,313 @@
+#include "library.h"
+#include "solver.h"
+#include "scheduler.h"
+#include "stats.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace BinaryNinja;
+
+// Headless driver that runs the all-functions solver over many binaries.
+// Several binaries are solved at once, each with its own thread budget, and
+// every input leaves a patched database and a JSON summary in the output
+// directory. One summary line per input is also printed to stdout.
+
+struct BatchOptions {
+    std::vector<std::string> inputs;
+    std::filesystem::path outputDirectory = ".";
+    size_t jobs = 1;
+    size_t threadsPerBinary = 0;
+    bool inlineAnalysis = false;
+    bool verbose = false;
+};
+
+static void PrintUsage(const char* program)
+{
+    fprintf(stderr,
+        "Usage: %s [options] <binary|directory>...\n"
+        "\n"
+        "Options:\n"
+        "  -o, --output-dir DIR  Directory for patched databases and summaries (default: .)\n"
+        "  -j, --jobs N          Number of binaries to solve at the same time (default: 1)\n"
+        "  -t, --threads N       Threads per binary (default: hardware threads / jobs)\n"
+        "  -l, --list FILE       Read additional inputs from FILE, one path per line\n"
+        "  -i, --inline          Resolve predicates during the initial analysis\n"
+        "  -v, --verbose         Log solver progress to stderr\n"
+        "  -h, --help            Show this help\n",
+        program);
+}
+
+static bool ParseCount(const char* text, size_t& value)
+{
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || parsed == 0)
+        return false;
+    value = static_cast<size_t>(parsed);
+    return true;
+}
+
+static bool ReadInputList(const std::string& path, std::vector<std::string>& inputs)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty() && line[0] != '#')
+            inputs.push_back(line);
+    }
+    return true;
+}
+
+static bool ParseArguments(int argc, char* argv[], BatchOptions& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "-i" || arg == "--inline") {
+            options.inlineAnalysis = true;
+        } else if (arg == "-v" || arg == "--verbose") {
+            options.verbose = true;
+        } else if ((arg == "-o" || arg == "--output-dir") && hasValue) {
+            options.outputDirectory = argv[++i];
+        } else if ((arg == "-j" || arg == "--jobs") && hasValue) {
+            if (!ParseCount(argv[++i], options.jobs))
+                return false;
+        } else if ((arg == "-t" || arg == "--threads") && hasValue) {
+            if (!ParseCount(argv[++i], options.threadsPerBinary))
+                return false;
+        } else if ((arg == "-l" || arg == "--list") && hasValue) {
+            if (!ReadInputList(argv[++i], options.inputs)) {
+                fprintf(stderr, "Failed to read input list %s\n", argv[i]);
+                return false;
+            }
+        } else if (!arg.empty() && arg[0] == '-') {
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return !options.inputs.empty();
+}
+
+// A binary to solve and where its results go, relative to the output
+// directory and without extension
+struct InputFile {
+    std::filesystem::path path;
+    std::filesystem::path outputStem;
+};
+
+// Expands directories into the regular files below them. Databases are
+// skipped so a rerun into the input directory does not pick up its own output.
+// Files found in a directory keep their path below it in the output
+// directory, so equally named files in different subdirectories do not
+// overwrite each other's results.
+static std::vector<InputFile> CollectInputFiles(const std::vector<std::string>& inputs)
+{
+    std::vector<InputFile> files;
+    for (const auto& input : inputs) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(input, ec)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(input, ec)) {
+                if (entry.is_regular_file(ec) && entry.path().extension() != ".bndb")
+                    files.push_back({entry.path(), entry.path().lexically_relative(input)});
+            }
+        } else {
+            files.push_back({input, std::filesystem::path(input).filename()});
+        }
+    }
+    return files;
+}
+
+// Reports every output path claimed by more than one input. Returns false if
+// there is any.
+static bool CheckDistinctOutputs(const std::vector<InputFile>& files)
+{
+    std::map<std::string, std::string> owners;
+    bool distinct = true;
+    for (const auto& file : files) {
+        auto [it, inserted] = owners.emplace(file.outputStem.lexically_normal().string(), file.path.string());
+        if (!inserted) {
+            fprintf(stderr, "%s and %s would both write %s\n", it->second.c_str(), file.path.string().c_str(), it->first.c_str());
+            distinct = false;
+        }
+    }
+    return distinct;
+}
+
+struct BinaryResult {
+    std::string input;
+    std::string database;
+    std::string status = "ok";
+    std::string error;
+    SolverResult solver;
+    size_t functions = 0;
+    size_t threads = 0;
+    uint64_t elapsedNanoseconds = 0;
+};
+
+static std::string FormatSummary(const BinaryResult& result)
+{
+    std::ostringstream out;
+    out << "{\"input\": \"" << EscapeJson(result.input) << "\"";
+    out << ", \"status\": \"" << result.status << "\"";
+    if (!result.error.empty())
+        out << ", \"error\": \"" << EscapeJson(result.error) << "\"";
+    if (!result.database.empty())
+        out << ", \"database\": \"" << EscapeJson(result.database) << "\"";
+    out << ", \"functions\": " << result.functions;
+    out << ", \"patches\": " << result.solver.patches;
+    out << ", \"passes\": " << result.solver.passes;
+    out << ", \"passLimitReached\": " << (result.solver.passLimitReached ? "true" : "false");
+    out << ", \"threads\": " << result.threads;
+    out << ", \"totalMs\": " << static_cast<double>(result.elapsedNanoseconds) / 1000000.0 << "}";
+    return out.str();
+}
+
+// Writes the summary of one input, with the run report spliced in if there is
+// one. Returns false if the file cannot be written.
+static bool WriteSummary(const std::filesystem::path& stem, const BinaryResult& result, const std::string& report)
+{
+    std::string summary = FormatSummary(result);
+    std::ofstream out(stem.string() + ".json");
+    if (report.empty()) {
+        out << summary << "\n";
+    } else {
+        out << summary.substr(0, summary.size() - 1) << ", \"report\": " << report << "}\n";
+    }
+    return static_cast<bool>(out);
+}
+
+static BinaryResult SolveBinary(const InputFile& file, const BatchOptions& options, size_t threadCount)
+{
+    const std::filesystem::path& input = file.path;
+    BinaryResult result;
+    result.input = input.string();
+    result.threads = threadCount;
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::filesystem::path stem = options.outputDirectory / file.outputStem;
+    std::error_code ec;
+    std::filesystem::create_directories(stem.parent_path(), ec);
+
+    // Failed inputs get a summary file too, so every input leaves one behind
+    auto finish = [&](const std::string& status, const std::string& error) {
+        result.status = status;
+        result.error = error;
+        result.elapsedNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+        WriteSummary(stem, result, "");
+        return result;
+    };
+
+    // Load waits for initial analysis to finish before returning. In inline
+    // mode that analysis already resolves most predicates, and the global
+    // passes below only pick up what is left.
+    std::string loadOptions = options.inlineAnalysis ? R"({"nativePredicateSolver.inlineAnalysis": true})" : "{}";
+    Ref<BinaryView> view = Load(input.string(), true, loadOptions);
+    if (!view)
+        return finish("error", "failed to open");
+
+    SolverOptions solverOptions = GetSolverOptions(view);
+    solverOptions.threadCount = static_cast<int>(threadCount);
+    // Nobody steps back through a batch run, so keep the saved undo history small
+    solverOptions.singleUndoAction = true;
+    RunStats stats;
+    result.functions = view->GetAnalysisFunctionList().size();
+    result.solver = SolveAllFunctions(view, solverOptions, {}, &stats);
+    view->UpdateAnalysisAndWait();
+
+    std::string database = stem.string() + ".bndb";
+    if (!view->CreateDatabase(database)) {
+        view->GetFile()->Close();
+        return finish("error", "failed to save database");
+    }
+    result.database = database;
+    result.elapsedNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+
+    auto nameForFunction = [&](uint64_t start) -> std::string {
+        auto functions = view->GetAnalysisFunctionsForAddress(start);
+        return functions.empty() ? "sub_" + std::to_string(start) : GetFunctionName(functions[0]);
+    };
+    std::string report = stats.ToJson("Batch", threadCount, result.elapsedNanoseconds, kReportSlowestFunctions, nameForFunction);
+    view->GetFile()->Close();
+
+    if (!WriteSummary(stem, result, report))
+        return finish("error", "failed to write summary");
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    BatchOptions options;
+    if (!ParseArguments(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(options.outputDirectory, ec);
+    if (!std::filesystem::is_directory(options.outputDirectory)) {
+        fprintf(stderr, "Failed to create output directory %s\n", options.outputDirectory.string().c_str());
+        return 1;
+    }
+
+    auto files = CollectInputFiles(options.inputs);
+    if (files.empty()) {
+        fprintf(stderr, "No input files\n");
+        return 1;
+    }
+    if (!CheckDistinctOutputs(files))
+        return 1;
+
+    size_t hardwareThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    size_t jobs = std::min(options.jobs, files.size());
+    size_t threadsPerBinary = options.threadsPerBinary ? options.threadsPerBinary : std::max<size_t>(1, hardwareThreads / jobs);
+
+    LogToStderr(options.verbose ? InfoLog : WarningLog);
+    SetBundledPluginDirectory(GetBundledPluginDirectory());
+    InitPlugins(false);
+    RegisterSolverSettings();
+    RegisterSolverWorkflow();
+
+    std::mutex outputMutex;
+    std::atomic<size_t> failures(0);
+
+    // Largest binaries first, so the longest solve does not start last
+    WorkStealingPool pool(jobs);
+    std::vector<std::pair<uint64_t, WorkStealingPool::Task>> tasks;
+    for (const auto& file : files) {
+        std::error_code sizeError;
+        uint64_t size = std::filesystem::file_size(file.path, sizeError);
+        tasks.emplace_back(sizeError ? 0 : size, [&, file]() {
+            BinaryResult result = SolveBinary(file, options, threadsPerBinary);
+            if (result.status != "ok")
+                failures.fetch_add(1);
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << FormatSummary(result) << std::endl;
+        });
+    }
+    pool.SubmitBatch(std::move(tasks));
+    pool.WaitIdle();
+
+    BNShutdown();
+    return failures.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+#include "core.h"
+#include "fakebackend.h"
+#include "stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs the all-functions solver over synthetic programs from FakeBackend and
+// reports throughput for every combination of thread count and per-function
+// pass limit. Needs no Binary Ninja installation.
+
+struct BenchmarkOptions {
+    FakeBackendConfig program;
+    std::vector<size_t> threadCounts;
+    std::vector<size_t> passLimits = {10};
+    SolverOptions solver;
+    bool showPasses = false;
+    bool reachable = false;
+};
+
+static void PrintUsage(const char* program)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "\n"
+        "Synthetic program:\n"
+        "  --functions N         Number of functions (default: 10000)\n"
+        "  --branches N          Average branches per function (default: 8)\n"
+        "  --opaque F            Fraction of branches that are opaque predicates (default: 0.3)\n"
+        "  --depth N             Longest chain of nested opaque predicates (default: 3)\n"
+        "  --calls N             Calls per function (default: 2)\n"
+        "  --evaluate-ns N       Simulated cost of evaluating one branch (default: 2000)\n"
+        "  --reanalysis-ns N     Simulated cost of reanalysing one function (default: 20000)\n"
+        "  --il-ns N             Simulated cost of generating one IL instruction (default: 50)\n"
+        "  --seed N              Generator seed (default: 1)\n"
+        "\n"
+        "Solver:\n"
+        "  --threads LIST        Comma separated thread counts (default: 1, 2, 4, ... up to the hardware threads)\n"
+        "  --passes LIST         Comma separated per-function pass limits (default: 10)\n"
+        "  --global-passes N     Maximum global passes (default: 20)\n"
+        "  --scope function|view Reanalysis scope (default: function)\n"
+        "  --parallel-threshold N  IL size above which a function is split across threads (default: 20000)\n"
+        "  --full-passes         Rescan every function on every global pass\n"
+        "  --reachable N         Only solve the first function and what it reaches within N calls\n"
+        "  --window-budget N     Stream through the program in windows of about N IL instructions (default: off)\n"
+        "  --show-passes         Print the per-pass breakdown of every run\n"
+        "  -v, --verbose         Log solver progress to stderr\n",
+        program);
+}
+
+static bool ParseNumber(const char* text, uint64_t& value)
+{
+    char* end = nullptr;
+    value = std::strtoull(text, &end, 10);
+    return end != text && *end == '\0';
+}
+
+static bool ParseList(const char* text, std::vector<size_t>& values)
+{
+    values.clear();
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        uint64_t value = 0;
+        if (!ParseNumber(item.c_str(), value) || value == 0)
+            return false;
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+static bool ParseArguments(int argc, char* argv[], BenchmarkOptions& options)
+{
+    // A fresh program per run has nothing cached, so only the bookkeeping
+    // would be measured
+    options.solver.verdictCache = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        uint64_t number = 0;
+        auto takeNumber = [&](auto& target) {
+            if (!value || !ParseNumber(value, number))
+                return false;
+            target = number;
+            ++i;
+            return true;
+        };
+
+        bool ok = true;
+        if (arg == "--functions") {
+            ok = takeNumber(options.program.functionCount);
+        } else if (arg == "--branches") {
+            ok = takeNumber(options.program.branchesPerFunction);
+        } else if (arg == "--opaque" && value) {
+            options.program.opaqueFraction = std::atof(argv[++i]);
+        } else if (arg == "--depth") {
+            ok = takeNumber(options.program.nestingDepth);
+        } else if (arg == "--calls") {
+            ok = takeNumber(options.program.callsPerFunction);
+        } else if (arg == "--evaluate-ns") {
+            ok = takeNumber(options.program.evaluateNanoseconds);
+        } else if (arg == "--reanalysis-ns") {
+            ok = takeNumber(options.program.reanalysisNanoseconds);
+        } else if (arg == "--il-ns") {
+            ok = takeNumber(options.program.ilNanosecondsPerInstruction);
+        } else if (arg == "--seed") {
+            ok = takeNumber(options.program.seed);
+        } else if (arg == "--threads" && value) {
+            ok = ParseList(argv[++i], options.threadCounts);
+        } else if (arg == "--passes" && value) {
+            ok = ParseList(argv[++i], options.passLimits);
+        } else if (arg == "--global-passes") {
+            ok = takeNumber(options.solver.maxGlobalPasses);
+        } else if (arg == "--scope" && value) {
+            std::string scope = argv[++i];
+            ok = scope == "function" || scope == "view";
+            options.solver.functionScopedReanalysis = scope == "function";
+        } else if (arg == "--parallel-threshold") {
+            ok = takeNumber(options.solver.parallelScanThreshold);
+        } else if (arg == "--window-budget") {
+            ok = takeNumber(options.solver.streamingWindowCost);
+        } else if (arg == "--reachable") {
+            options.reachable = takeNumber(options.solver.reachableDepth);
+            ok = options.reachable;
+        } else if (arg == "--full-passes") {
+            options.solver.incrementalGlobalPasses = false;
+        } else if (arg == "--show-passes") {
+            options.showPasses = true;
+        } else if (arg == "-v" || arg == "--verbose") {
+            options.program.verbose = true;
+        } else {
+            ok = false;
+        }
+        if (!ok)
+            return false;
+    }
+
+    if (options.reachable && options.program.functionCount == 0)
+        return false;
+
+    if (options.threadCounts.empty()) {
+        size_t hardwareThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        for (size_t threads = 1; threads < hardwareThreads; threads *= 2)
+            options.threadCounts.push_back(threads);
+        options.threadCounts.push_back(hardwareThreads);
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchmarkOptions options;
+    if (!ParseArguments(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    {
+        FakeBackend probe(options.program);
+        printf("%zu functions, %zu branches, %zu opaque predicates (nesting depth %zu)\n",
+               options.program.functionCount, probe.GetBranchCount(), probe.GetOpaquePredicateCount(), options.program.nestingDepth);
+        if (options.reachable) {
+            printf("%zu opaque predicates within %zu calls of the first function\n", probe.GetReachableOpaquePredicateCount(options.solver.reachableDepth),
+                   options.solver.reachableDepth);
+        }
+        printf("\n");
+    }
+
+    printf("%8s %8s %10s %8s %10s %10s %14s %8s %10s\n", "threads", "passes", "wall ms", "global", "patches", "missed", "functions/s", "speedup", "peak IL");
+
+    bool allComplete = true;
+    for (size_t passLimit : options.passLimits) {
+        double baselineMs = 0;
+        for (size_t threads : options.threadCounts) {
+            FakeBackend backend(options.program);
+            SolverOptions solverOptions = options.solver;
+            solverOptions.threadCount = static_cast<int>(threads);
+            solverOptions.maxPassesPerFunction = static_cast<int>(passLimit);
+
+            RunStats stats;
+            auto start = std::chrono::steady_clock::now();
+            SolverResult result = options.reachable
+                ? SolveReachableFunctions(backend, backend.GetFirstFunction(), solverOptions, {}, &stats)
+                : SolveAllFunctions(backend, solverOptions, {}, &stats);
+            double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            auto passes = stats.GetPasses();
+            size_t scannedFunctions = 0;
+            for (const auto& pass : passes)
+                scannedFunctions += pass.functions;
+
+            if (baselineMs == 0)
+                baselineMs = wallMs;
+            size_t expected = options.reachable ? backend.GetReachableOpaquePredicateCount(solverOptions.reachableDepth) : backend.GetOpaquePredicateCount();
+            size_t missed = expected - backend.GetPatchedCount();
+            allComplete &= missed == 0 || result.passLimitReached;
+
+            printf("%8zu %8zu %10.1f %8d %10d %10zu %14.0f %7.2fx %10llu\n", threads, passLimit, wallMs, result.passes, result.patches, missed,
+                   scannedFunctions / (wallMs / 1000.0), baselineMs / wallMs, static_cast<unsigned long long>(backend.GetPeakResidentInstructions()));
+            if (options.showPasses) {
+                for (const auto& pass : passes) {
+                    printf("%28s pass %d: %zu functions, %zu patches, %.1f ms\n", "", pass.pass, pass.functions, pass.patches,
+                           static_cast<double>(pass.nanoseconds) / 1000000.0);
+                }
+            }
+            fflush(stdout);
+        }
+    }
+
+    // A run that stopped before its pass limit has to have found everything
+    return allComplete ? 0 : 1;
+}
@@ -0,0 +1,807 @@
+#include "core.h"
+#include "scheduler.h"
+#include "stats.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+static void Log(SolverBackend& backend, SolverLogLevel level, const char* fmt, ...)
+{
+    char message[512];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+    backend.Log(level, message);
+}
+
+static bool IsCancelled(const SolverCallbacks& callbacks)
+{
+    return callbacks.isCancelled && callbacks.isCancelled();
+}
+
+static void SetProgressText(const SolverCallbacks& callbacks, const std::string& text)
+{
+    if (callbacks.setProgressText)
+        callbacks.setProgressText(text);
+}
+
+static uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Keeps the writes made during its lifetime in one undoable action
+class PatchGroup
+{
+public:
+    PatchGroup(SolverBackend& backend, bool enabled)
+        : m_backend(backend), m_enabled(enabled)
+    {
+        if (m_enabled)
+            m_backend.BeginPatchGroup();
+    }
+
+    ~PatchGroup()
+    {
+        if (m_enabled)
+            m_backend.EndPatchGroup();
+    }
+
+private:
+    SolverBackend& m_backend;
+    bool m_enabled;
+};
+
+// Collects the functions touched by patches during a global pass so the next
+// pass only has to revisit those (and their neighbours) instead of the whole
+// binary.
+class FunctionWorklist
+{
+public:
+    void RecordPatch(uint64_t functionStart, uint64_t address)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_patchedFunctions.insert(functionStart);
+        m_patchAddresses.insert(address);
+    }
+
+    // Builds the function list for the next global pass and resets the dirty
+    // state. Must be called after analysis has been updated so that callees
+    // uncovered by the patches are already known to the backend.
+    std::vector<SolverFunctionRef> TakeDirtyFunctions(SolverBackend& backend)
+    {
+        std::set<uint64_t> patchedFunctions;
+        std::set<uint64_t> patchAddresses;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            patchedFunctions.swap(m_patchedFunctions);
+            patchAddresses.swap(m_patchAddresses);
+        }
+
+        auto result = backend.GetDirtyFunctions(patchedFunctions, patchAddresses);
+        std::sort(result.begin(), result.end(), [](const SolverFunctionRef& a, const SolverFunctionRef& b) {
+            return a->GetStart() < b->GetStart();
+        });
+        return result;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::set<uint64_t> m_patchedFunctions;
+    std::set<uint64_t> m_patchAddresses;
+};
+
+// Outcome of the last scan of every function, persisted with the program so
+// later runs can skip functions that have not changed. An entry only counts
+// once its function has converged; a function that is patched and then runs
+// out of passes keeps no valid fingerprint and is rescanned.
+class VerdictCache
+{
+public:
+    static constexpr const char* kFormatVersion = "1";
+
+    void Load(SolverBackend& backend)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.clear();
+
+        // One line per function: "<start> <fingerprint> <address><j|n>..." in hex
+        std::istringstream in(backend.LoadVerdicts());
+        std::string line;
+        if (!std::getline(in, line) || line != kFormatVersion)
+            return;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            uint64_t start = 0;
+            Entry entry;
+            if (!(fields >> std::hex >> start >> entry.fingerprint))
+                continue;
+            std::string patch;
+            while (fields >> patch) {
+                if (patch.size() < 2)
+                    continue;
+                entry.patches.emplace_back(std::strtoull(patch.c_str(), nullptr, 16), patch.back() == 'j');
+            }
+            m_entries[start] = std::move(entry);
+        }
+    }
+
+    void Save(SolverBackend& backend) const
+    {
+        std::ostringstream out;
+        out << kFormatVersion << '\n' << std::hex;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const auto& [start, entry] : m_entries) {
+                out << start << ' ' << entry.fingerprint;
+                for (const auto& [address, alwaysBranch] : entry.patches)
+                    out << ' ' << address << (alwaysBranch ? 'j' : 'n');
+                out << '\n';
+            }
+        }
+        backend.StoreVerdicts(out.str());
+    }
+
+    bool IsUnchanged(uint64_t start, uint64_t fingerprint) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(start);
+        return it != m_entries.end() && it->second.fingerprint != kInvalidFingerprint && it->second.fingerprint == fingerprint;
+    }
+
+    void RecordPatches(uint64_t start, const std::vector<SolverPatch>& patches)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& entry = m_entries[start];
+        entry.fingerprint = kInvalidFingerprint;
+        for (const auto& patch : patches)
+            entry.patches.emplace_back(patch.address, patch.alwaysBranch);
+    }
+
+    void RecordConverged(uint64_t start, uint64_t fingerprint)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries[start].fingerprint = fingerprint;
+    }
+
+private:
+    static constexpr uint64_t kInvalidFingerprint = 0;
+
+    struct Entry {
+        uint64_t fingerprint = kInvalidFingerprint;
+        std::vector<std::pair<uint64_t, bool>> patches;
+    };
+
+    mutable std::mutex m_mutex;
+    std::map<uint64_t, Entry> m_entries;
+};
+
+// Runs a global pass as a two stage pipeline. Scanner tasks only read the
+// backend and produce SolverPatch records; a single committer thread owns
+// every write. The committer coalesces whatever the scanners have produced
+// into one batch, applies it with a single reanalysis and then feeds the
+// patched functions back to the scanners for their next per-function pass.
+// Scanning runs on a work-stealing pool that lives as long as the pipeline,
+// so the same threads serve every global pass.
+class PatchPipeline
+{
+public:
+    // Patches collected before the committer stops waiting for more
+    static constexpr size_t kCommitBatchSize = 256;
+    // Longest time the committer holds a partial batch while scanners are busy
+    static constexpr std::chrono::milliseconds kCommitWindow{250};
+
+    PatchPipeline(SolverBackend& backend, const SolverOptions& options, FunctionWorklist& worklist, RunStats* stats, VerdictCache* verdicts)
+        : m_backend(backend), m_maxPassesPerFunction(options.maxPassesPerFunction),
+          m_functionScopedReanalysis(options.functionScopedReanalysis), m_worklist(worklist), m_stats(stats), m_verdicts(verdicts),
+          m_pool(options.threadCount)
+    {
+        m_scanContext = {&m_pool, options.parallelScanThreshold, [this]() { return m_shouldCancel.load(); }, m_stats};
+    }
+
+    // Processes the given functions until each converges or runs out of
+    // per-function passes. With skipUnchanged, functions whose code matches
+    // their cached verdict are not scanned at all. Returns the number of
+    // patches applied.
+    int Run(const std::vector<SolverFunctionRef>& functions, const SolverCallbacks& callbacks, const std::string& progressPrefix, bool skipUnchanged)
+    {
+        m_totalFunctions = functions.size();
+        m_skipUnchanged = skipUnchanged && m_verdicts;
+        m_skippedFunctions.store(0);
+        m_processedFunctions.store(0);
+        m_outstandingScans.store(0);
+        m_patchCount.store(0);
+        m_shouldCancel.store(false);
+        m_done = false;
+        m_commitQueue.clear();
+
+        std::vector<std::pair<uint64_t, WorkStealingPool::Task>> initial;
+        initial.reserve(functions.size());
+        m_outstandingScans.fetch_add(functions.size());
+        for (auto& func : functions) {
+            initial.emplace_back(EstimateCost(func), [this, func]() { Scan(func, 1); });
+        }
+        m_pool.SubmitBatch(std::move(initial));
+
+        std::thread committer([this]() { CommitterLoop(); });
+
+        size_t lastProcessed = 0;
+        bool cancelLogged = false;
+        while (m_processedFunctions.load() < m_totalFunctions && !m_shouldCancel.load()) {
+            if (IsCancelled(callbacks)) {
+                m_shouldCancel.store(true);
+                if (!cancelLogged) {
+                    Log(m_backend, SolverLogLevel::Warning, "Cancelling operation...");
+                    cancelLogged = true;
+                }
+            }
+
+            size_t currentProcessed = m_processedFunctions.load();
+            if (currentProcessed != lastProcessed) {
+                lastProcessed = currentProcessed;
+                int percentage = (currentProcessed * 100) / m_totalFunctions;
+                SetProgressText(callbacks, progressPrefix + " (" + std::to_string(percentage) + "%)");
+            }
+
+            std::unique_lock<std::mutex> lock(m_progressMutex);
+            m_progressCv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_commitMutex);
+            m_done = true;
+        }
+        m_commitCv.notify_all();
+        if (committer.joinable())
+            committer.join();
+
+        // Scans still queued after a cancel see m_shouldCancel and return early
+        m_pool.WaitIdle();
+        return m_patchCount.load();
+    }
+
+    size_t GetSkippedFunctionCount() const { return m_skippedFunctions.load(); }
+
+private:
+    struct ScanResult {
+        SolverFunctionRef func;
+        int pass;
+        std::vector<SolverPatch> patches;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    // Functions scanned before are weighted by their IL size, unseen ones by
+    // the backend's estimate
+    uint64_t EstimateCost(const SolverFunctionRef& func)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_costMutex);
+            auto it = m_costs.find(func->GetStart());
+            if (it != m_costs.end())
+                return it->second;
+        }
+        return m_backend.EstimateCost(func);
+    }
+
+    void Enqueue(const SolverFunctionRef& func, int pass)
+    {
+        m_outstandingScans.fetch_add(1);
+        m_pool.Submit([this, func, pass]() { Scan(func, pass); }, EstimateCost(func));
+    }
+
+    void FinishFunction()
+    {
+        if (m_processedFunctions.fetch_add(1) + 1 == m_totalFunctions)
+            m_progressCv.notify_all();
+    }
+
+    void Scan(const SolverFunctionRef& func, int pass)
+    {
+        std::vector<SolverPatch> patches;
+        if (!m_shouldCancel.load()) {
+            bool unchanged = false;
+            if (pass == 1 && m_skipUnchanged) {
+                unchanged = m_verdicts->IsUnchanged(func->GetStart(), m_backend.ComputeFingerprint(func));
+                if (unchanged)
+                    m_skippedFunctions.fetch_add(1);
+            }
+
+            size_t instructionCount = 0;
+            if (!unchanged) {
+                patches = ScanFunction(m_backend, func, m_scanContext, instructionCount);
+                {
+                    std::lock_guard<std::mutex> lock(m_costMutex);
+                    m_costs[func->GetStart()] = instructionCount;
+                }
+
+                // Nothing left to patch: remember the code this verdict applies to
+                if (m_verdicts && patches.empty() && instructionCount != 0 && !m_shouldCancel.load())
+                    m_verdicts->RecordConverged(func->GetStart(), m_backend.ComputeFingerprint(func));
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_commitMutex);
+        if (patches.empty() || m_shouldCancel.load()) {
+            FinishFunction();
+        } else {
+            m_commitQueue.push_back({func, pass, std::move(patches), std::chrono::steady_clock::now()});
+        }
+        m_outstandingScans.fetch_sub(1);
+        m_commitCv.notify_one();
+    }
+
+    void CommitterLoop()
+    {
+        while (true) {
+            std::vector<ScanResult> batch;
+            {
+                std::unique_lock<std::mutex> lock(m_commitMutex);
+                m_commitCv.wait(lock, [&] { return !m_commitQueue.empty() || m_done; });
+                if (m_done)
+                    break;
+
+                // Let busy scanners top up the batch, but never wait on idle ones
+                m_commitCv.wait_for(lock, kCommitWindow, [&] {
+                    return m_done || m_outstandingScans.load() == 0 || PendingPatchCount() >= kCommitBatchSize;
+                });
+                if (m_done)
+                    break;
+                batch.swap(m_commitQueue);
+            }
+
+            if (m_stats) {
+                auto now = std::chrono::steady_clock::now();
+                for (const auto& result : batch)
+                    m_stats->AddPhaseTime(SolverPhase::CommitWait, std::chrono::duration_cast<std::chrono::nanoseconds>(now - result.queuedAt).count());
+            }
+
+            if (m_shouldCancel.load())
+                break;
+
+            // Only functions that really changed are recorded and rescanned; a
+            // result whose writes all failed would otherwise rescan the same code
+            int batchPatches = 0;
+            std::vector<SolverFunctionRef> affected;
+            std::vector<bool> changed(batch.size(), false);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const auto& result = batch[i];
+                size_t written;
+                {
+                    PhaseTimer timer(m_stats, SolverPhase::PatchWrite);
+                    written = m_backend.ApplyPatches(result.func, result.patches);
+                }
+                if (written == 0)
+                    continue;
+
+                changed[i] = true;
+                if (m_functionScopedReanalysis) {
+                    auto resultAffected = m_backend.GetAffectedFunctions(result.func, result.patches);
+                    affected.insert(affected.end(), resultAffected.begin(), resultAffected.end());
+                }
+                for (const auto& patch : result.patches)
+                    m_worklist.RecordPatch(result.func->GetStart(), patch.address);
+                if (m_verdicts)
+                    m_verdicts->RecordPatches(result.func->GetStart(), result.patches);
+                batchPatches += written;
+            }
+
+            // One reanalysis for the whole batch; wait for it so rescans see the new IL
+            if (batchPatches > 0) {
+                PhaseTimer timer(m_stats, SolverPhase::Reanalysis);
+                m_backend.Reanalyze(affected, m_functionScopedReanalysis, [this]() { return m_shouldCancel.load(); });
+            }
+            m_patchCount.fetch_add(batchPatches);
+
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const auto& result = batch[i];
+                SolverFunctionRef updated;
+                if (changed[i] && result.pass < m_maxPassesPerFunction && !m_shouldCancel.load())
+                    updated = m_backend.Refresh(result.func);
+
+                if (updated) {
+                    Enqueue(updated, result.pass + 1);
+                } else {
+                    FinishFunction();
+                }
+            }
+        }
+    }
+
+    size_t PendingPatchCount() const
+    {
+        size_t count = 0;
+        for (const auto& result : m_commitQueue)
+            count += result.patches.size();
+        return count;
+    }
+
+    SolverBackend& m_backend;
+    int m_maxPassesPerFunction;
+    bool m_functionScopedReanalysis;
+    FunctionWorklist& m_worklist;
+    RunStats* m_stats;
+    VerdictCache* m_verdicts;
+    bool m_skipUnchanged = false;
+
+    ScanContext m_scanContext;
+    std::unordered_map<uint64_t, uint64_t> m_costs;
+    std::mutex m_costMutex;
+
+    size_t m_totalFunctions = 0;
+    std::atomic<size_t> m_processedFunctions{0};
+    std::atomic<size_t> m_skippedFunctions{0};
+    std::atomic<size_t> m_outstandingScans{0};
+    std::atomic<int> m_patchCount{0};
+    std::atomic<bool> m_shouldCancel{false};
+    bool m_done = false;
+    std::mutex m_progressMutex;
+    std::condition_variable m_progressCv;
+
+    std::vector<ScanResult> m_commitQueue;
+    std::mutex m_commitMutex;
+    std::condition_variable m_commitCv;
+
+    // Declared last so the workers are joined before the state they use goes away
+    WorkStealingPool m_pool;
+};
+
+std::vector<SolverPatch> EvaluateSites(const ScanContext& ctx, size_t instructionCount, size_t siteCount,
+                                       const std::function<void(size_t, size_t, std::vector<SolverPatch>&)>& evaluate)
+{
+    std::vector<SolverPatch> patches;
+    if (!ctx.pool || instructionCount < ctx.parallelThreshold || siteCount < 2) {
+        evaluate(0, siteCount, patches);
+        return patches;
+    }
+
+    // Oversized function: evaluate slices of the site list on every thread and
+    // merge the per-slice results back in site order
+    size_t chunkSize = std::max<size_t>(16, siteCount / (ctx.pool->GetThreadCount() * 4));
+    std::vector<std::vector<SolverPatch>> chunkPatches((siteCount + chunkSize - 1) / chunkSize);
+    ctx.pool->ParallelFor(siteCount, chunkSize, [&](size_t begin, size_t end) {
+        evaluate(begin, end, chunkPatches[begin / chunkSize]);
+    });
+    for (auto& chunk : chunkPatches)
+        patches.insert(patches.end(), chunk.begin(), chunk.end());
+    return patches;
+}
+
+std::vector<SolverPatch> ScanFunction(SolverBackend& backend, const SolverFunctionRef& func, const ScanContext& ctx, size_t& instructionCount)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    auto patches = backend.ScanFunction(func, ctx, instructionCount);
+    if (ctx.stats)
+        ctx.stats->RecordFunctionScan(func->GetStart(), ElapsedNanoseconds(startTime), instructionCount, patches.size());
+    return patches;
+}
+
+SolverResult SolveFunction(SolverBackend& backend, SolverFunctionRef func, const SolverOptions& options, const SolverCallbacks& callbacks,
+                           RunStats* stats)
+{
+    SolverResult result;
+
+    // A single function has nothing else to overlap with, so always split it
+    WorkStealingPool pool(options.threadCount);
+    ScanContext scanContext = {&pool, 0, [&]() { return IsCancelled(callbacks); }, stats};
+    PatchGroup runGroup(backend, options.singleUndoAction);
+
+    int pass = 1;
+    while (pass <= options.maxPassesPerFunction) {
+        if (IsCancelled(callbacks)) {
+            Log(backend, SolverLogLevel::Warning, "Operation cancelled by user");
+            result.cancelled = true;
+            break;
+        }
+
+        SetProgressText(callbacks, "Pass " + std::to_string(pass) + "/" + std::to_string(options.maxPassesPerFunction));
+        auto passStart = std::chrono::steady_clock::now();
+        result.passes = pass;
+
+        size_t instructionCount = 0;
+        auto patches = ScanFunction(backend, func, scanContext, instructionCount);
+        if (instructionCount == 0) {
+            break;
+        }
+
+        size_t written = 0;
+        if (!patches.empty()) {
+            PatchGroup group(backend, !options.singleUndoAction);
+            PhaseTimer timer(stats, SolverPhase::PatchWrite);
+            written = backend.ApplyPatches(func, patches);
+        }
+
+        int patchCount = static_cast<int>(written);
+        result.patches += patchCount;
+
+        if (patchCount == 0) {
+            if (stats)
+                stats->RecordPass(pass, 1, 0, ElapsedNanoseconds(passStart));
+            break;
+        }
+
+        {
+            PhaseTimer timer(stats, SolverPhase::Reanalysis);
+            backend.Reanalyze(backend.GetAffectedFunctions(func, patches), options.functionScopedReanalysis,
+                              [&]() { return IsCancelled(callbacks); });
+        }
+        if (stats)
+            stats->RecordPass(pass, 1, patchCount, ElapsedNanoseconds(passStart));
+
+        if (auto updated = backend.Refresh(func))
+            func = updated;
+
+        pass++;
+    }
+
+    result.passLimitReached = pass > options.maxPassesPerFunction;
+    backend.ReleaseFunctions({func});
+    return result;
+}
+
+struct PassOutcome {
+    size_t functions = 0;
+    int patches = 0;
+    size_t skipped = 0;
+};
+
+// Runs one global pass over the given functions, or over every function if
+// allFunctions is set. Without a window budget this is a single pipeline
+// run. With one, functions are taken in address order in windows whose
+// estimated cost stays within options.streamingWindowCost, and the backend
+// releases what it holds for each window once the window is done, so memory
+// follows the window size rather than the size of the binary.
+static PassOutcome RunGlobalPass(SolverBackend& backend, PatchPipeline& pipeline, const SolverOptions& options, const SolverCallbacks& callbacks,
+                                 int globalPass, std::vector<SolverFunctionRef> functions, bool allFunctions)
+{
+    PassOutcome outcome;
+    std::string passPrefix = "Global pass " + std::to_string(globalPass);
+    std::string threads = " with " + std::to_string(options.threadCount) + " threads";
+
+    // Only the first pass trusts cached verdicts; later passes revisit
+    // functions because something around them changed in this run
+    auto runWindow = [&](const std::vector<SolverFunctionRef>& window, const std::string& progressPrefix) {
+        SetProgressText(callbacks, progressPrefix);
+        outcome.patches += pipeline.Run(window, callbacks, progressPrefix, globalPass == 1);
+        outcome.functions += window.size();
+        outcome.skipped += pipeline.GetSkippedFunctionCount();
+        // Whatever was kept for these functions is stale once they have been
+        // patched and reanalysed, and the next pass rebuilds what it needs
+        backend.ReleaseFunctions(window);
+    };
+
+    if (options.streamingWindowCost == 0) {
+        if (allFunctions)
+            functions = backend.GetFunctions();
+        if (!functions.empty())
+            runWindow(functions, passPrefix + " - Analyzing " + std::to_string(functions.size()) + " functions" + threads);
+        return outcome;
+    }
+
+    size_t windowCount = 0;
+    size_t next = 0;
+    uint64_t cursor = 0;
+    while (!IsCancelled(callbacks)) {
+        std::vector<SolverFunctionRef> window;
+        if (allFunctions) {
+            window = backend.GetFunctionWindow(cursor, options.streamingWindowCost);
+            if (window.empty())
+                break;
+            cursor = window.back()->GetStart() + 1;
+        } else {
+            uint64_t cost = 0;
+            while (next < functions.size() && (window.empty() || cost < options.streamingWindowCost)) {
+                cost += backend.EstimateCost(functions[next]);
+                window.push_back(std::move(functions[next++]));
+            }
+            if (window.empty())
+                break;
+        }
+
+        char start[32];
+        snprintf(start, sizeof(start), "0x%llx", static_cast<unsigned long long>(window.front()->GetStart()));
+        runWindow(window, passPrefix + " - Window " + std::to_string(++windowCount) + ", " + std::to_string(window.size()) + " functions from " + start + threads);
+    }
+    return outcome;
+}
+
+// The functions reachable from a root through at most maxDepth calls. The
+// scope only grows: when patches uncover new call sites, the callees they
+// lead to are added with the depth of the call that reaches them.
+class ReachableScope
+{
+public:
+    ReachableScope(SolverBackend& backend, size_t maxDepth)
+        : m_backend(backend), m_maxDepth(maxDepth)
+    {
+    }
+
+    // Adds func at depth together with everything it reaches. Returns how
+    // many functions were not in scope before.
+    size_t Expand(const SolverFunctionRef& func, size_t depth)
+    {
+        size_t added = 0;
+        std::vector<std::pair<SolverFunctionRef, size_t>> queue = {{func, depth}};
+        for (size_t i = 0; i < queue.size(); ++i) {
+            auto [current, currentDepth] = queue[i];
+            auto it = m_functions.find(current->GetStart());
+            if (it == m_functions.end()) {
+                m_functions[current->GetStart()] = {current, currentDepth, false};
+                added++;
+            } else if (currentDepth < it->second.depth || i == 0) {
+                // Reached along a shorter path, or revisited after a patch
+                it->second.func = current;
+                it->second.depth = std::min(currentDepth, it->second.depth);
+                currentDepth = it->second.depth;
+            } else {
+                continue;
+            }
+
+            if (currentDepth < m_maxDepth) {
+                for (auto& callee : m_backend.GetCallees(current))
+                    queue.emplace_back(callee, currentDepth + 1);
+            }
+        }
+        return added;
+    }
+
+    // Follows the call sites of the in-scope functions affected by the last
+    // pass, then returns those functions together with every function that
+    // was reached only now, ordered by start address
+    std::vector<SolverFunctionRef> TakeAffected(const std::vector<SolverFunctionRef>& affected, size_t& added)
+    {
+        added = 0;
+        std::set<uint64_t> affectedStarts;
+        for (const auto& func : affected) {
+            affectedStarts.insert(func->GetStart());
+            auto it = m_functions.find(func->GetStart());
+            if (it != m_functions.end())
+                added += Expand(func, it->second.depth);
+        }
+
+        std::vector<SolverFunctionRef> result;
+        for (auto& [start, entry] : m_functions) {
+            if (entry.scanned && affectedStarts.count(start) == 0)
+                continue;
+            entry.scanned = true;
+            result.push_back(entry.func);
+        }
+        return result;
+    }
+
+    // Every function in scope, ordered by start address
+    std::vector<SolverFunctionRef> TakeAll()
+    {
+        std::vector<SolverFunctionRef> result;
+        for (auto& entry : m_functions) {
+            entry.second.scanned = true;
+            result.push_back(entry.second.func);
+        }
+        return result;
+    }
+
+    size_t GetSize() const { return m_functions.size(); }
+
+private:
+    struct Entry {
+        SolverFunctionRef func;
+        size_t depth;
+        bool scanned;
+    };
+
+    SolverBackend& m_backend;
+    size_t m_maxDepth;
+    std::map<uint64_t, Entry> m_functions;
+};
+
+// Global passes shared by SolveAllFunctions and SolveReachableFunctions.
+// Without a scope every function is covered; with one, only the functions in
+// it are, and the scope is widened after every pass.
+static SolverResult RunGlobalPasses(SolverBackend& backend, const SolverOptions& options, const SolverCallbacks& callbacks, RunStats* stats,
+                                    ReachableScope* scope)
+{
+    SolverResult result;
+    int globalPass = 1;
+    FunctionWorklist worklist;
+    VerdictCache verdicts;
+    if (options.verdictCache)
+        verdicts.Load(backend);
+    PatchPipeline pipeline(backend, options, worklist, stats, options.verdictCache ? &verdicts : nullptr);
+    PatchGroup runGroup(backend, options.singleUndoAction);
+
+    while (true) {
+        if (IsCancelled(callbacks)) {
+            Log(backend, SolverLogLevel::Warning, "Operation cancelled by user");
+            result.cancelled = true;
+            break;
+        }
+
+        bool allFunctions = false;
+        std::vector<SolverFunctionRef> functions;
+        if (scope && globalPass == 1) {
+            functions = scope->TakeAll();
+        } else if (scope) {
+            size_t added = 0;
+            functions = scope->TakeAffected(worklist.TakeDirtyFunctions(backend), added);
+            if (!options.incrementalGlobalPasses)
+                functions = scope->TakeAll();
+            Log(backend, SolverLogLevel::Info, "[+] Pass %d: rescanning %zu reachable functions, %zu reached through new call sites", globalPass,
+                functions.size(), added);
+        } else if (globalPass == 1 || !options.incrementalGlobalPasses) {
+            allFunctions = true;
+        } else {
+            functions = worklist.TakeDirtyFunctions(backend);
+            Log(backend, SolverLogLevel::Info, "[+] Pass %d: rescanning %zu functions affected by previous patches", globalPass, functions.size());
+        }
+        result.passes = globalPass;
+
+        auto passStart = std::chrono::steady_clock::now();
+        PassOutcome outcome;
+        {
+            PatchGroup passGroup(backend, !options.singleUndoAction);
+            outcome = RunGlobalPass(backend, pipeline, options, callbacks, globalPass, std::move(functions), allFunctions);
+        }
+        // A pass cut short by cancellation may scan nothing and patch nothing,
+        // which must not read as having converged
+        bool cancelled = IsCancelled(callbacks);
+        if (outcome.functions == 0 && !cancelled) {
+            Log(backend, SolverLogLevel::Info, "No functions to process");
+            break;
+        }
+
+        if (stats)
+            stats->RecordPass(globalPass, outcome.functions, outcome.patches, ElapsedNanoseconds(passStart));
+        result.patches += outcome.patches;
+        if (outcome.skipped != 0)
+            Log(backend, SolverLogLevel::Info, "[+] Pass %d: skipped %zu unchanged functions with cached verdicts", globalPass, outcome.skipped);
+        Log(backend, SolverLogLevel::Info, "[+] Pass %d: %d patches applied", globalPass, outcome.patches);
+
+        if (cancelled) {
+            Log(backend, SolverLogLevel::Warning, "Operation cancelled by user");
+            result.cancelled = true;
+            break;
+        }
+        if (outcome.patches == 0)
+            break;
+
+        globalPass++;
+
+        if (globalPass > options.maxGlobalPasses) {
+            Log(backend, SolverLogLevel::Warning, "[!] Maximum passes reached");
+            result.passLimitReached = true;
+            break;
+        }
+
+        SetProgressText(callbacks, "Updating analysis after pass " + std::to_string(globalPass - 1));
+        backend.UpdateAnalysis();
+    }
+
+    if (options.verdictCache)
+        verdicts.Save(backend);
+    return result;
+}
+
+SolverResult SolveAllFunctions(SolverBackend& backend, const SolverOptions& options, const SolverCallbacks& callbacks, RunStats* stats)
+{
+    return RunGlobalPasses(backend, options, callbacks, stats, nullptr);
+}
+
+SolverResult SolveReachableFunctions(SolverBackend& backend, const SolverFunctionRef& root, const SolverOptions& options,
+                                     const SolverCallbacks& callbacks, RunStats* stats)
+{
+    SetProgressText(callbacks, "Collecting functions reachable within " + std::to_string(options.reachableDepth) + " calls");
+    ReachableScope scope(backend, options.reachableDepth);
+    scope.Expand(root, 0);
+    Log(backend, SolverLogLevel::Info, "[+] %zu functions reachable within %zu calls", scope.GetSize(), options.reachableDepth);
+    return RunGlobalPasses(backend, options, callbacks, stats, &scope);
+}
@@ -0,0 +1,92 @@
+// MIT License
+//
+// Copyright (c) 2015-2024 Vector 35 Inc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef NATIVE_PREDICATE_SOLVER_CORE_H
+#define NATIVE_PREDICATE_SOLVER_CORE_H
+
+#include "backend.h"
+#include "stats.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Tunables for a solver run. The plugin commands read them from the
+// nativePredicateSolver.* settings; the batch driver and the benchmark may
+// override them.
+struct SolverOptions {
+    int maxPassesPerFunction = 10;
+    int maxGlobalPasses = 20;
+    int threadCount = 8;
+    bool incrementalGlobalPasses = true;
+    bool functionScopedReanalysis = true;
+    size_t parallelScanThreshold = 20000;
+    bool verdictCache = true;
+    // Estimated scan cost of the functions processed together when streaming
+    // through the binary in windows; 0 processes every function at once
+    uint64_t streamingWindowCost = 0;
+    // Record the whole run as one undoable action instead of one per pass
+    bool singleUndoAction = false;
+    // Calls followed from the root by SolveReachableFunctions
+    size_t reachableDepth = 8;
+};
+
+// How a run reports progress and learns that it should stop. Either member
+// may be empty.
+struct SolverCallbacks {
+    std::function<void(const std::string&)> setProgressText;
+    std::function<bool()> isCancelled;
+};
+
+struct SolverResult {
+    int patches = 0;
+    int passes = 0;
+    bool cancelled = false;
+    bool passLimitReached = false;
+};
+
+// Evaluates siteCount branch sites of one function through
+// evaluate(begin, end, patches). Functions with at least
+// ctx.parallelThreshold IL instructions are split across ctx.pool, and the
+// per-slice results are merged back in site order.
+std::vector<SolverPatch> EvaluateSites(const ScanContext& ctx, size_t instructionCount, size_t siteCount,
+                                       const std::function<void(size_t, size_t, std::vector<SolverPatch>&)>& evaluate);
+
+// SolverBackend::ScanFunction, recorded in ctx.stats
+std::vector<SolverPatch> ScanFunction(SolverBackend& backend, const SolverFunctionRef& func, const ScanContext& ctx, size_t& instructionCount);
+
+// Patches one function repeatedly until it has no opaque predicates left or
+// maxPassesPerFunction is reached. Its branches are evaluated on threadCount
+// threads.
+SolverResult SolveFunction(SolverBackend& backend, SolverFunctionRef func, const SolverOptions& options, const SolverCallbacks& callbacks,
+                           RunStats* stats);
+
+// Runs global passes over every function until a pass applies no patches or
+// maxGlobalPasses is reached.
+SolverResult SolveAllFunctions(SolverBackend& backend, const SolverOptions& options, const SolverCallbacks& callbacks, RunStats* stats);
+
+// Like SolveAllFunctions, but only over root and the functions it reaches
+// through at most reachableDepth calls. Call sites uncovered by patches are
+// followed after every pass, so the set grows as predicates are removed.
+SolverResult SolveReachableFunctions(SolverBackend& backend, const SolverFunctionRef& root, const SolverOptions& options,
+                                     const SolverCallbacks& callbacks, RunStats* stats);
+
+#endif //NATIVE_PREDICATE_SOLVER_CORE_H
@@ -0,0 +1,337 @@
+#include "fakebackend.h"
+#include "core.h"
+#include "hash.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+static constexpr uint64_t kImageBase = 0x400000;
+static constexpr uint64_t kFunctionAlignment = 0x1000;
+static constexpr uint64_t kFirstBranchOffset = 0x10;
+static constexpr uint64_t kBranchSpacing = 8;
+static constexpr size_t kBaseInstructions = 8;
+
+// Burns CPU for the given time, standing in for analysis work
+static void Spin(uint64_t nanoseconds)
+{
+    if (nanoseconds == 0)
+        return;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(nanoseconds);
+    while (std::chrono::steady_clock::now() < deadline) {
+    }
+}
+
+FakeBackend::FakeBackend(const FakeBackendConfig& config)
+    : m_config(config)
+{
+    std::mt19937_64 rng(config.seed);
+    size_t maxBranches = std::min<size_t>(config.branchesPerFunction * 2, (kFunctionAlignment - kFirstBranchOffset) / kBranchSpacing);
+    std::uniform_int_distribution<size_t> branchCount(0, maxBranches);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+    for (size_t i = 0; i < config.functionCount; ++i) {
+        auto func = std::make_shared<FakeFunction>();
+        func->start = kImageBase + i * kFunctionAlignment;
+        func->index = i;
+
+        // Any branch may sit in code that only an earlier opaque predicate
+        // hides, as long as that keeps the chain within nestingDepth
+        std::vector<size_t> depth;
+        int lastOpaque = -1;
+        size_t count = branchCount(rng);
+        for (size_t j = 0; j < count; ++j) {
+            Branch branch;
+            branch.address = func->start + kFirstBranchOffset + j * kBranchSpacing;
+            branch.opaque = chance(rng) < config.opaqueFraction;
+            branch.alwaysBranch = chance(rng) < 0.5;
+            branch.parent = -1;
+            if (lastOpaque >= 0 && depth[lastOpaque] + 1 < config.nestingDepth && chance(rng) < 0.5)
+                branch.parent = lastOpaque;
+
+            depth.push_back(branch.parent < 0 ? 0 : depth[branch.parent] + 1);
+            if (branch.opaque) {
+                lastOpaque = static_cast<int>(j);
+                m_opaqueCount++;
+            }
+            func->branches.push_back(branch);
+        }
+        m_branchCount += count;
+        func->written.assign(count, false);
+        func->analysed.assign(count, false);
+        m_functions.push_back(func);
+    }
+
+    if (config.functionCount > 1) {
+        std::uniform_int_distribution<size_t> target(0, config.functionCount - 1);
+        for (auto& func : m_functions) {
+            for (size_t i = 0; i < config.callsPerFunction; ++i) {
+                size_t callee = target(rng);
+                if (callee == func->index)
+                    continue;
+                func->callees.push_back(callee);
+                m_functions[callee]->callers.push_back(func->index);
+            }
+        }
+    }
+}
+
+size_t FakeBackend::GetPatchedCount() const
+{
+    size_t count = 0;
+    for (auto& func : m_functions) {
+        std::lock_guard<std::mutex> lock(func->mutex);
+        for (size_t i = 0; i < func->branches.size(); ++i)
+            count += func->written[i] && func->branches[i].opaque;
+    }
+    return count;
+}
+
+size_t FakeBackend::GetReachableOpaquePredicateCount(size_t depth) const
+{
+    if (m_functions.empty())
+        return 0;
+
+    std::vector<size_t> reached(m_functions.size(), SIZE_MAX);
+    std::vector<size_t> queue = {0};
+    reached[0] = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < queue.size(); ++i) {
+        const auto& func = *m_functions[queue[i]];
+        for (const auto& branch : func.branches)
+            count += branch.opaque;
+        if (reached[func.index] == depth)
+            continue;
+        for (size_t callee : func.callees) {
+            if (reached[callee] == SIZE_MAX) {
+                reached[callee] = reached[func.index] + 1;
+                queue.push_back(callee);
+            }
+        }
+    }
+    return count;
+}
+
+FakeBackend::FakeFunction* FakeBackend::Find(uint64_t address) const
+{
+    if (address < kImageBase)
+        return nullptr;
+    size_t index = (address - kImageBase) / kFunctionAlignment;
+    return index < m_functions.size() ? m_functions[index].get() : nullptr;
+}
+
+std::vector<SolverFunctionRef> FakeBackend::GetFunctions()
+{
+    return std::vector<SolverFunctionRef>(m_functions.begin(), m_functions.end());
+}
+
+std::vector<SolverFunctionRef> FakeBackend::GetFunctionWindow(uint64_t start, uint64_t maxCost)
+{
+    size_t index = start <= kImageBase ? 0 : (start - kImageBase + kFunctionAlignment - 1) / kFunctionAlignment;
+    std::vector<SolverFunctionRef> result;
+    uint64_t cost = 0;
+    for (; index < m_functions.size() && (result.empty() || cost < maxCost); ++index) {
+        result.push_back(m_functions[index]);
+        cost += GetInstructionCount(*m_functions[index]);
+    }
+    return result;
+}
+
+void FakeBackend::ReleaseFunctions(const std::vector<SolverFunctionRef>& functions)
+{
+    for (auto& func : functions) {
+        auto& fake = Get(func);
+        std::lock_guard<std::mutex> lock(fake.mutex);
+        DropIL(fake);
+    }
+}
+
+SolverFunctionRef FakeBackend::Refresh(const SolverFunctionRef& func)
+{
+    // Synthetic functions are never removed, only reanalysed in place
+    return func;
+}
+
+size_t FakeBackend::GetInstructionCount(const FakeFunction& func) const
+{
+    return kBaseInstructions + func.branches.size() * m_config.instructionsPerBranch;
+}
+
+void FakeBackend::DropIL(FakeFunction& func)
+{
+    if (func.ilCached) {
+        m_residentInstructions.fetch_sub(GetInstructionCount(func));
+        func.ilCached = false;
+    }
+}
+
+uint64_t FakeBackend::EstimateCost(const SolverFunctionRef& func)
+{
+    return GetInstructionCount(Get(func));
+}
+
+std::vector<SolverPatch> FakeBackend::ScanFunction(const SolverFunctionRef& func, const ScanContext& ctx, size_t& instructionCount)
+{
+    auto& fake = Get(func);
+    instructionCount = GetInstructionCount(fake);
+
+    std::vector<bool> analysed;
+    bool ilCached;
+    {
+        std::lock_guard<std::mutex> lock(fake.mutex);
+        analysed = fake.analysed;
+        ilCached = fake.ilCached;
+        if (!ilCached) {
+            fake.ilCached = true;
+            uint64_t resident = m_residentInstructions.fetch_add(instructionCount) + instructionCount;
+            uint64_t peak = m_peakResidentInstructions.load();
+            while (resident > peak && !m_peakResidentInstructions.compare_exchange_weak(peak, resident)) {
+            }
+        }
+    }
+    if (!ilCached) {
+        PhaseTimer timer(ctx.stats, SolverPhase::MediumLevelIL);
+        Spin(instructionCount * m_config.ilNanosecondsPerInstruction);
+    }
+
+    // Branches already patched are gone from the IL, and those behind an
+    // unpatched predicate are not reachable yet
+    std::vector<size_t> sites;
+    for (size_t i = 0; i < fake.branches.size(); ++i) {
+        int parent = fake.branches[i].parent;
+        if (!analysed[i] && (parent < 0 || analysed[parent]))
+            sites.push_back(i);
+    }
+
+    return EvaluateSites(ctx, instructionCount, sites.size(), [&](size_t begin, size_t end, std::vector<SolverPatch>& patches) {
+        for (size_t i = begin; i < end; ++i) {
+            if ((i - begin) % 100 == 0 && ctx.isCancelled())
+                break;
+
+            const auto& branch = fake.branches[sites[i]];
+            {
+                PhaseTimer timer(ctx.stats, SolverPhase::ExprValue);
+                Spin(m_config.evaluateNanoseconds);
+            }
+            if (branch.opaque)
+                patches.push_back({branch.address, branch.alwaysBranch});
+        }
+    });
+}
+
+uint64_t FakeBackend::ComputeFingerprint(const SolverFunctionRef& func)
+{
+    auto& fake = Get(func);
+    std::lock_guard<std::mutex> lock(fake.mutex);
+    Fnv1aHash hash;
+    hash.AddValue(fake.start);
+    for (size_t i = 0; i < fake.branches.size(); ++i)
+        hash.AddValue(static_cast<uint8_t>(fake.written[i]));
+    return hash.Get();
+}
+
+size_t FakeBackend::ApplyPatches(const SolverFunctionRef& func, const std::vector<SolverPatch>& patches)
+{
+    auto& fake = Get(func);
+    std::lock_guard<std::mutex> lock(fake.mutex);
+    size_t written = 0;
+    for (const auto& patch : patches) {
+        size_t index = (patch.address - fake.start - kFirstBranchOffset) / kBranchSpacing;
+        if (index < fake.written.size()) {
+            fake.written[index] = true;
+            fake.stale = true;
+            written++;
+        }
+    }
+    return written;
+}
+
+std::vector<SolverFunctionRef> FakeBackend::GetCallees(const SolverFunctionRef& func)
+{
+    std::vector<SolverFunctionRef> result;
+    for (size_t callee : Get(func).callees)
+        result.push_back(m_functions[callee]);
+    return result;
+}
+
+std::vector<SolverFunctionRef> FakeBackend::GetAffectedFunctions(const SolverFunctionRef& func, const std::vector<SolverPatch>&)
+{
+    // Synthetic functions never share instructions
+    return {func};
+}
+
+void FakeBackend::ReanalyzeFunction(FakeFunction& func)
+{
+    Spin(m_config.reanalysisNanoseconds);
+    std::lock_guard<std::mutex> lock(func.mutex);
+    func.analysed = func.written;
+    DropIL(func);
+    func.stale = false;
+}
+
+void FakeBackend::Reanalyze(const std::vector<SolverFunctionRef>& functions, bool functionScope, const std::function<bool()>& isCancelled)
+{
+    if (!functionScope) {
+        UpdateAnalysis();
+        return;
+    }
+
+    for (auto& func : functions) {
+        if (isCancelled())
+            break;
+        ReanalyzeFunction(Get(func));
+    }
+}
+
+void FakeBackend::UpdateAnalysis()
+{
+    for (auto& func : m_functions) {
+        bool stale;
+        {
+            std::lock_guard<std::mutex> lock(func->mutex);
+            stale = func->stale;
+        }
+        if (stale)
+            ReanalyzeFunction(*func);
+    }
+}
+
+std::vector<SolverFunctionRef> FakeBackend::GetDirtyFunctions(const std::set<uint64_t>& patchedFunctions, const std::set<uint64_t>& patchAddresses)
+{
+    std::set<size_t> dirty;
+    for (uint64_t address : patchAddresses) {
+        if (auto func = Find(address))
+            dirty.insert(func->index);
+    }
+    for (uint64_t start : patchedFunctions) {
+        auto func = Find(start);
+        if (!func)
+            continue;
+        dirty.insert(func->index);
+        dirty.insert(func->callers.begin(), func->callers.end());
+        dirty.insert(func->callees.begin(), func->callees.end());
+    }
+
+    std::vector<SolverFunctionRef> result;
+    for (size_t index : dirty)
+        result.push_back(m_functions[index]);
+    return result;
+}
+
+std::string FakeBackend::LoadVerdicts()
+{
+    std::lock_guard<std::mutex> lock(m_verdictMutex);
+    return m_verdicts;
+}
+
+void FakeBackend::StoreVerdicts(const std::string& verdicts)
+{
+    std::lock_guard<std::mutex> lock(m_verdictMutex);
+    m_verdicts = verdicts;
+}
+
+void FakeBackend::Log(SolverLogLevel level, const std::string& message)
+{
+    if (m_config.verbose || level == SolverLogLevel::Warning)
+        fprintf(stderr, "%s\n", message.c_str());
+}
@@ -0,0 +1,146 @@
+// MIT License
+//
+// Copyright (c) 2015-2024 Vector 35 Inc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef NATIVE_PREDICATE_SOLVER_FAKEBACKEND_H
+#define NATIVE_PREDICATE_SOLVER_FAKEBACKEND_H
+
+#include "backend.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Shape and cost model of a synthetic program for FakeBackend
+struct FakeBackendConfig {
+    size_t functionCount = 10000;
+    // Each function gets between zero and twice this many conditional branches
+    size_t branchesPerFunction = 8;
+    // Share of the branches whose condition is constant
+    double opaqueFraction = 0.3;
+    // Longest chain of opaque predicates where each one only becomes visible
+    // once the one before it has been patched and its function reanalysed.
+    // 1 means every predicate is visible from the start.
+    size_t nestingDepth = 3;
+    // Calls from each function to other functions, for incremental passes
+    size_t callsPerFunction = 2;
+    // IL instructions per branch, which sets the scheduling cost of a function
+    size_t instructionsPerBranch = 12;
+    // CPU time spent generating IL per instruction after each reanalysis
+    uint64_t ilNanosecondsPerInstruction = 50;
+    // CPU time spent evaluating one branch condition
+    uint64_t evaluateNanoseconds = 2000;
+    // CPU time spent reanalysing one function
+    uint64_t reanalysisNanoseconds = 20000;
+    uint64_t seed = 1;
+    bool verbose = false;
+};
+
+// In-memory SolverBackend over a generated program. Work is simulated by
+// spinning for the configured time, so results scale with real cores the way
+// a Binary Ninja run does. Generation is deterministic for a given seed.
+class FakeBackend : public SolverBackend
+{
+public:
+    explicit FakeBackend(const FakeBackendConfig& config);
+
+    // Opaque predicates in the generated program, all of which a complete run
+    // should patch
+    size_t GetOpaquePredicateCount() const { return m_opaqueCount; }
+    size_t GetBranchCount() const { return m_branchCount; }
+    // Opaque predicates in the first function and the functions it reaches
+    // through at most depth calls
+    size_t GetReachableOpaquePredicateCount(size_t depth) const;
+    // The function the reachable counts start from
+    SolverFunctionRef GetFirstFunction() const { return m_functions.front(); }
+    // Opaque predicates patched so far
+    size_t GetPatchedCount() const;
+    // Most IL instructions that were cached at the same time during the run
+    uint64_t GetPeakResidentInstructions() const { return m_peakResidentInstructions.load(); }
+
+    std::vector<SolverFunctionRef> GetFunctions() override;
+    std::vector<SolverFunctionRef> GetFunctionWindow(uint64_t start, uint64_t maxCost) override;
+    void ReleaseFunctions(const std::vector<SolverFunctionRef>& functions) override;
+    SolverFunctionRef Refresh(const SolverFunctionRef& func) override;
+    uint64_t EstimateCost(const SolverFunctionRef& func) override;
+    std::vector<SolverPatch> ScanFunction(const SolverFunctionRef& func, const ScanContext& ctx, size_t& instructionCount) override;
+    uint64_t ComputeFingerprint(const SolverFunctionRef& func) override;
+    size_t ApplyPatches(const SolverFunctionRef& func, const std::vector<SolverPatch>& patches) override;
+    // The synthetic program keeps no undo history
+    void BeginPatchGroup() override {}
+    void EndPatchGroup() override {}
+    std::vector<SolverFunctionRef> GetCallees(const SolverFunctionRef& func) override;
+    std::vector<SolverFunctionRef> GetAffectedFunctions(const SolverFunctionRef& func, const std::vector<SolverPatch>& patches) override;
+    void Reanalyze(const std::vector<SolverFunctionRef>& functions, bool functionScope, const std::function<bool()>& isCancelled) override;
+    void UpdateAnalysis() override;
+    std::vector<SolverFunctionRef> GetDirtyFunctions(const std::set<uint64_t>& patchedFunctions, const std::set<uint64_t>& patchAddresses) override;
+    std::string LoadVerdicts() override;
+    void StoreVerdicts(const std::string& verdicts) override;
+    void Log(SolverLogLevel level, const std::string& message) override;
+
+private:
+    struct Branch {
+        uint64_t address;
+        bool opaque;
+        bool alwaysBranch;
+        // Branch that has to be patched before this one is visible, or -1
+        int parent;
+    };
+
+    struct FakeFunction : public SolverFunction {
+        uint64_t GetStart() const override { return start; }
+
+        uint64_t start;
+        size_t index;
+        std::vector<Branch> branches;
+        std::vector<size_t> callees;
+        std::vector<size_t> callers;
+
+        std::mutex mutex;
+        // Patches written to the program
+        std::vector<bool> written;
+        // Patches the current analysis has seen
+        std::vector<bool> analysed;
+        bool ilCached = false;
+        bool stale = false;
+    };
+
+    FakeFunction& Get(const SolverFunctionRef& func) const { return static_cast<FakeFunction&>(*func); }
+    FakeFunction* Find(uint64_t start) const;
+    size_t GetInstructionCount(const FakeFunction& func) const;
+    // Drops the cached IL of func; the caller holds func.mutex
+    void DropIL(FakeFunction& func);
+    void ReanalyzeFunction(FakeFunction& func);
+
+    FakeBackendConfig m_config;
+    std::vector<std::shared_ptr<FakeFunction>> m_functions;
+    size_t m_opaqueCount = 0;
+    size_t m_branchCount = 0;
+    std::atomic<uint64_t> m_residentInstructions{0};
+    std::atomic<uint64_t> m_peakResidentInstructions{0};
+
+    std::mutex m_verdictMutex;
+    std::string m_verdicts;
+};
+
+#endif //NATIVE_PREDICATE_SOLVER_FAKEBACKEND_H
@@ -0,0 +1,57 @@
+// MIT License
+//
+// Copyright (c) 2015-2024 Vector 35 Inc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef NATIVE_PREDICATE_SOLVER_HASH_H
+#define NATIVE_PREDICATE_SOLVER_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Incremental 64-bit FNV-1a. Not cryptographic; used to fingerprint code and
+// expressions so results can be reused when nothing has changed.
+class Fnv1aHash
+{
+public:
+    void Add(const void* data, size_t length)
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < length; ++i) {
+            m_hash ^= bytes[i];
+            m_hash *= 0x100000001b3ull;
+        }
+    }
+
+    template <typename T>
+    void AddValue(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Add(&value, sizeof(value));
+    }
+
+    uint64_t Get() const { return m_hash; }
+
+private:
+    uint64_t m_hash = 0xcbf29ce484222325ull;
+};
+
+#endif //NATIVE_PREDICATE_SOLVER_HASH_H
@@ -1,43 +1,29 @@
 #include "library.h"
+#include "solver.h"
+#include "shapecache.h"
+#include "stats.h"
 #include <thread>
 #include <vector>
-#include <atomic>
-#include <mutex>
 #include <chrono>
-#include <queue>
-#include <condition_variable>
 
 using namespace BinaryNinja;
 
+static SolverCallbacks TaskCallbacks(const Ref<BackgroundTask>& task)
+{
+    return {
+        [task](const std::string& text) { task->SetProgressText(text); },
+        [task]() { return task->IsCancelled(); }
+    };
+}
+
 extern "C"
 {
     BN_DECLARE_CORE_ABI_VERSION
 
         BINARYNINJAPLUGIN bool CorePluginInit()
     {
-        auto settings = Settings::Instance();
-        settings->RegisterGroup("nativePredicateSolver", "Native Predicate Solver");
-        settings->RegisterSetting("nativePredicateSolver.maxPassesPerFunction",
-            R"~({
-                            "title": "Max passes per function",
-                            "type": "number",
-                            "default": 10,
-                            "description": "Maximum number of passes to run when patching opaque predicates in a single function."
-                            })~");
-        settings->RegisterSetting("nativePredicateSolver.maxGlobalPasses",
-            R"~({
-                            "title": "Max global passes",
-                            "type": "number",
-                            "default": 20,
-                            "description": "Maximum number of global passes when patching all functions in the binary."
-                            })~");
-        settings->RegisterSetting("nativePredicateSolver.threadCount",
-            R"~({
-                            "title": "Thread count",
-                            "type": "number",
-                            "default": 8,
-                            "description": "Number of threads to use when patching all functions. Recommended: number of CPU cores."
-                            })~");
+        RegisterSolverSettings();
+        RegisterSolverWorkflow();
 
         PluginCommand::Register(
             "Native Predicate Solver\\Patch Opaque Predicates (Current Function)",
@@ -63,341 +49,193 @@ extern "C"
                     return;
                 }
 
-                std::string funcName = func->GetSymbol() ? func->GetSymbol()->GetShortName() : "sub_" + std::to_string(func->GetStart());
+                std::string funcName = GetFunctionName(func);
 
                 Ref<BinaryView> viewRef = view;
                 Ref<Function> funcRef = func;
-                Ref<Architecture> archRef = arch;
 
-                std::thread([viewRef, funcRef, archRef, funcName]() mutable {
+                std::thread([viewRef, funcRef, funcName]() {
                     Ref<BackgroundTask> task = new BackgroundTask("Patching opaque predicates", true);
                     task->SetProgressText("Processing " + funcName);
                     
                     auto startTime = std::chrono::high_resolution_clock::now();
 
-                    int totalPatches = 0;
-                    int pass = 1;
-                    auto settings = Settings::Instance();
-                    const int maxPasses = static_cast<int>(settings->Get<int64_t>("nativePredicateSolver.maxPassesPerFunction", viewRef));
-
-                    while (pass <= maxPasses) {
-                        if (task->IsCancelled()) {
-                            LogWarn("Operation cancelled by user");
-                            break;
-                        }
-
-                        task->SetProgressText("Pass " + std::to_string(pass) + "/" + std::to_string(maxPasses) + " for " + funcName);
-
-                        auto mlil = funcRef->GetMediumLevelIL();
-                        if (!mlil) {
-                            break;
-                        }
-
-                        int patchCount = 0;
-                        size_t instructionCount = mlil->GetInstructionCount();
-
-                        for (size_t i = 0; i < instructionCount; ++i) {
-                            if (i % 100 == 0 && task->IsCancelled()) {
-                                break;
-                            }
-                            
-                            auto instr = mlil->GetInstruction(i);
-                            if (instr.operation != MLIL_IF)
-                                continue;
-
-                            auto val = mlil->GetExprValue(instr.GetConditionExpr());
-                            if (val.state == BNRegisterValueType::ConstantValue) {
-                                if (val.value == 0) {
-                                    if (viewRef->IsNeverBranchPatchAvailable(archRef, instr.address)) {
-                                        viewRef->ConvertToNop(archRef, instr.address);
-                                        patchCount++;
-                                    }
-                                }
-                                else {
-                                    if (viewRef->IsAlwaysBranchPatchAvailable(archRef, instr.address)) {
-                                        viewRef->AlwaysBranch(archRef, instr.address);
-                                        patchCount++;
-                                    }
-                                }
-                            }
-                        }
-
-                        totalPatches += patchCount;
-
-                        if (patchCount == 0)
-                            break;
-
-                        viewRef->UpdateAnalysis();
-                        
-                        auto updatedFunctions = viewRef->GetAnalysisFunctionsContainingAddress(funcRef->GetStart());
-                        if (!updatedFunctions.empty()) {
-                            funcRef = updatedFunctions[0];
-                        }
-                        
-                        pass++;
-                    }
+                    SolverOptions options = GetSolverOptions(viewRef);
+                    RunStats stats;
+                    SolverCallbacks callbacks = TaskCallbacks(task);
+                    callbacks.setProgressText = [task, funcName](const std::string& text) { task->SetProgressText(text + " for " + funcName); };
+                    SolverResult result = SolveFunction(viewRef, funcRef, options, callbacks, &stats);
 
                     task->Finish();
                     
                     auto endTime = std::chrono::high_resolution_clock::now();
                     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-                    LogInfo("[+] Completed: %d patches applied to %s in %lld ms", totalPatches, funcName.c_str(), duration.count());
+                    LogInfo("[+] Completed: %d patches applied to %s in %lld ms", result.patches, funcName.c_str(), duration.count());
+                    LogInfo("[+] Time by phase: %s", stats.GetSummary().c_str());
+                    WriteRunReport(viewRef, stats, "Patch Opaque Predicates (Current Function)", options.threadCount,
+                                   std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime));
                     }).detach();
             });
 
-        struct PatchInfo {
-            Ref<Architecture> arch;
-            uint64_t address;
-            bool alwaysBranch;
-        };
-
-        auto processFunctionBatch = [](Ref<BinaryView> viewRef, 
-                                       const std::vector<Ref<Function>>& funcBatch,
-                                       int maxPassesPerFunction,
-                                       std::atomic<int>& patchCount,
-                                       std::atomic<bool>& shouldCancel,
-                                       std::mutex& updateMutex,
-                                       std::atomic<size_t>& processedFunctions) {
-            int localPatchCount = 0;
-            
-            for (auto func : funcBatch) {
-                if (shouldCancel.load())
-                    break;
-                    
-                auto mlil = func->GetMediumLevelIL();
-                if (!mlil || mlil->GetInstructionCount() == 0) {
-                    processedFunctions.fetch_add(1);
-                    continue;
-                }
-                    
-                auto arch = func->GetArchitecture();
-                if (!arch) {
-                    processedFunctions.fetch_add(1);
-                    continue;
-                }
-                
-                size_t instrCount = mlil->GetInstructionCount();
-                //if (instrCount > 10000) {
-                //    std::string funcName = func->GetSymbol() ? func->GetSymbol()->GetShortName() : "sub_" + std::to_string(func->GetStart());
-                //    LogInfo("Processing large function %s with %zu instructions", funcName.c_str(), instrCount);
-                //}
-                    
-                int funcPatches = 0;
-                int pass = 1;
-                
-                while (pass <= maxPassesPerFunction) {
-                    std::vector<PatchInfo> pendingPatches;
-                    
-                    for (size_t i = 0; i < mlil->GetInstructionCount(); ++i) {
-                        if (i % 100 == 0 && shouldCancel.load()) {
-                            break;
-                        }
-                        
-                        auto instr = mlil->GetInstruction(i);
-                        if (instr.operation != MLIL_IF)
-                            continue;
-                            
-                        auto val = mlil->GetExprValue(instr.GetConditionExpr());
-                        if (val.state == BNRegisterValueType::ConstantValue) {
-                            if (val.value == 0) {
-                                if (viewRef->IsNeverBranchPatchAvailable(arch, instr.address)) {
-                                    pendingPatches.push_back({arch, instr.address, false});
-                                }
-                            }
-                            else {
-                                if (viewRef->IsAlwaysBranchPatchAvailable(arch, instr.address)) {
-                                    pendingPatches.push_back({arch, instr.address, true});
-                                }
-                            }
-                        }
-                    }
-                    
-                    if (shouldCancel.load()) {
-                        break;
-                    }
-                    
-                    if (pendingPatches.empty())
-                        break;
-                    
-                    {
-                        std::lock_guard<std::mutex> lock(updateMutex);
-                        for (const auto& patch : pendingPatches) {
-                            if (patch.alwaysBranch) {
-                                viewRef->AlwaysBranch(patch.arch, patch.address);
-                            } else {
-                                viewRef->ConvertToNop(patch.arch, patch.address);
-                            }
-                        }
-                        viewRef->UpdateAnalysis();
-                    }
-                    
-                    funcPatches += pendingPatches.size();
-                    pass++;
-                }
-                
-                localPatchCount += funcPatches;
-                processedFunctions.fetch_add(1);
-            }
-            
-            patchCount.fetch_add(localPatchCount);
-        };
-
         PluginCommand::Register(
             "Native Predicate Solver\\Patch Opaque Predicates (All Functions)",
             "Recursively patch opaque predicates in all functions until none remain",
-            [processFunctionBatch](BinaryView* view) {
+            [](BinaryView* view) {
                 Ref<BinaryView> viewRef = view;
 
-                std::thread([viewRef, processFunctionBatch]() {
+                std::thread([viewRef]() {
                     Ref<BackgroundTask> task = new BackgroundTask("Patching all opaque predicates", true);
                     task->SetProgressText("Starting recursive patching for entire binary");
                     
                     auto startTime = std::chrono::high_resolution_clock::now();
 
-                    auto settings = Settings::Instance();
-                    const int maxGlobalPasses = static_cast<int>(settings->Get<int64_t>("nativePredicateSolver.maxGlobalPasses", viewRef));
-                    const int maxPassesPerFunction = static_cast<int>(settings->Get<int64_t>("nativePredicateSolver.maxPassesPerFunction", viewRef));
-                    int threadCount = static_cast<int>(settings->Get<int64_t>("nativePredicateSolver.threadCount", viewRef));
-                    if (threadCount < 1) threadCount = 1;
-                    
-                    int globalPass = 1;
-                    int totalGlobalPatches = 0;
-                    
-                    while (true) {
-                        if (task->IsCancelled()) {
-                            LogWarn("Operation cancelled by user");
-                            break;
-                        }
-                        
-                        auto functions = viewRef->GetAnalysisFunctionList();
-                        size_t totalFuncs = functions.size();
-                        
-                        if (totalFuncs == 0) {
-                            LogInfo("No functions to process");
-                            break;
-                        }
-                        
-                        task->SetProgressText("Global pass " + std::to_string(globalPass) + " - Analyzing " + std::to_string(totalFuncs) + " functions with " + std::to_string(threadCount) + " threads");
-                        
-                        std::atomic<int> globalPatchCount(0);
-                        std::atomic<bool> shouldCancel(false);
-                        std::atomic<size_t> processedFunctions(0);
-                        std::mutex updateMutex;
-                        
-                        std::queue<Ref<Function>> workQueue;
-                        std::mutex queueMutex;
-                        std::condition_variable cv;
-                        std::atomic<bool> workDone(false);
-                        
-                        for (auto& func : functions) {
-                            workQueue.push(func);
-                        }
-                        
-                        auto worker = [&]() {
-                            while (true) {
-                                std::vector<Ref<Function>> localBatch;
-                                
-                                {
-                                    std::unique_lock<std::mutex> lock(queueMutex);
-                                    
-                                    cv.wait(lock, [&] { return !workQueue.empty() || workDone.load() || shouldCancel.load(); });
-                                    
-                                    if ((workDone.load() && workQueue.empty()) || shouldCancel.load())
-                                        break;
-                                    
-                                    size_t remaining = workQueue.size();
-                                    size_t batchSize = 1;
-                                    if (remaining > 100) {
-                                        batchSize = 5;
-                                    } else if (remaining > 50) {
-                                        batchSize = 3;
-                                    } else if (remaining > 20) {
-                                        batchSize = 2;
-                                    }
-                                    
-                                    for (size_t i = 0; i < batchSize && !workQueue.empty(); ++i) {
-                                        localBatch.push_back(workQueue.front());
-                                        workQueue.pop();
-                                    }
-                                }
-                                
-                                if (!localBatch.empty()) {
-                                    processFunctionBatch(viewRef, localBatch, maxPassesPerFunction,
-                                                       globalPatchCount, shouldCancel, updateMutex, processedFunctions);
-                                }
-                            }
-                        };
-                        
-                        std::vector<std::thread> threads;
-                        for (int i = 0; i < threadCount; ++i) {
-                            threads.emplace_back(worker);
-                        }
-                        
-                        size_t lastProcessed = 0;
-                        bool cancelLogged = false;
-                        while (processedFunctions.load() < totalFuncs) {
-                            if (task->IsCancelled()) {
-                                shouldCancel.store(true);
-                                if (!cancelLogged) {
-                                    LogWarn("Cancelling operation...");
-                                    cancelLogged = true;
-                                }
-                            }
-                            
-                            size_t currentProcessed = processedFunctions.load();
-                            if (currentProcessed != lastProcessed) {
-                                lastProcessed = currentProcessed;
-                                int percentage = (currentProcessed * 100) / totalFuncs;
-                                task->SetProgressText("Global pass " + std::to_string(globalPass) + 
-                                                    " - Analyzing " + std::to_string(totalFuncs) + 
-                                                    " functions with " + std::to_string(threadCount) + 
-                                                    " threads (" + std::to_string(percentage) + "%)");
-                            }
-                            
-                            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                        }
-                        
-                        {
-                            std::lock_guard<std::mutex> lock(queueMutex);
-                            workDone.store(true);
-                        }
-                        cv.notify_all();
-                        
-                        for (auto& t : threads) {
-                            if (t.joinable())
-                                t.join();
-                        }
-                        
-                        int patchesThisPass = globalPatchCount.load();
-                        totalGlobalPatches += patchesThisPass;
-                        LogInfo("[+] Pass %d: %d patches applied", globalPass, patchesThisPass);
-                        
-                        if (patchesThisPass == 0)
-                            break;
-                            
-                        globalPass++;
-                        
-                        if (globalPass > maxGlobalPasses) {
-                            LogWarn("[!] Maximum passes reached");
-                            break;
-                        }
-                        
-                        task->SetProgressText("Updating analysis after pass " + std::to_string(globalPass - 1));
-                        viewRef->UpdateAnalysis();
-                    }
-                    
+                    SolverOptions options = GetSolverOptions(viewRef);
+                    RunStats stats;
+                    SolverResult result = SolveAllFunctions(viewRef, options, TaskCallbacks(task), &stats);
+
                     task->Finish();
                     
                     auto endTime = std::chrono::high_resolution_clock::now();
                     auto duration = std::chrono::duration_cast<std::chrono::seconds>(endTime - startTime);
-                    LogInfo("[+] Completed: %d total patches applied in %lld seconds", totalGlobalPatches, duration.count());
+                    LogInfo("[+] Completed: %d total patches applied in %lld seconds", result.patches, duration.count());
+                    LogInfo("[+] Time by phase: %s", stats.GetSummary().c_str());
+                    WriteRunReport(viewRef, stats, "Patch Opaque Predicates (All Functions)", options.threadCount,
+                                   std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime));
                     }).detach();
             });
 
+        PluginCommand::Register(
+            "Native Predicate Solver\\Patch Opaque Predicates (Reachable From Current Function)",
+            "Patch opaque predicates in the current function and the functions it calls, following calls uncovered by patches",
+            [](BinaryView* view) {
+                uint64_t addr = view->GetCurrentOffset();
+                auto functions = view->GetAnalysisFunctionsContainingAddress(addr);
+                if (functions.empty()) {
+                    LogWarn("No function at current address 0x%llx", addr);
+                    return;
+                }
+
+                Ref<BinaryView> viewRef = view;
+                Ref<Function> root = functions[0];
+                std::string rootName = GetFunctionName(root);
+
+                std::thread([viewRef, root, rootName]() {
+                    Ref<BackgroundTask> task = new BackgroundTask("Patching opaque predicates reachable from " + rootName, true);
+
+                    auto startTime = std::chrono::high_resolution_clock::now();
+
+                    SolverOptions options = GetSolverOptions(viewRef);
+                    RunStats stats;
+                    SolverResult result = SolveReachableFunctions(viewRef, root, options, TaskCallbacks(task), &stats);
+
+                    task->Finish();
+
+                    auto endTime = std::chrono::high_resolution_clock::now();
+                    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+                    LogInfo("[+] Completed: %d patches applied to functions reachable from %s in %lld ms", result.patches, rootName.c_str(),
+                            duration.count());
+                    LogInfo("[+] Time by phase: %s", stats.GetSummary().c_str());
+                    WriteRunReport(viewRef, stats, "Patch Opaque Predicates (Reachable From Current Function)", options.threadCount,
+                                   std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime));
+                    }).detach();
+            });
+
+        PluginCommand::Register(
+            "Native Predicate Solver\\Scan Only (Export Patch Plan)",
+            "Find opaque predicates in all functions without patching and save them as a patch plan",
+            [](BinaryView* view) {
+                std::string path;
+                if (!GetSaveFileNameInput(path, "Save patch plan", "*.npsplan", "patches.npsplan"))
+                    return;
+
+                Ref<BinaryView> viewRef = view;
+                std::thread([viewRef, path]() {
+                    Ref<BackgroundTask> task = new BackgroundTask("Scanning for opaque predicates", true);
+                    auto startTime = std::chrono::high_resolution_clock::now();
+
+                    std::vector<PlanEntry> entries;
+                    bool completed = ScanPatchPlan(viewRef, GetSolverOptions(viewRef), TaskCallbacks(task), entries);
+
+                    task->Finish();
+                    if (!completed) {
+                        LogWarn("Operation cancelled by user");
+                        return;
+                    }
+
+                    if (!WritePatchPlan(path, entries)) {
+                        LogError("Failed to write patch plan to %s", path.c_str());
+                        return;
+                    }
+
+                    auto endTime = std::chrono::high_resolution_clock::now();
+                    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+                    LogInfo("[+] Patch plan with %zu patches written to %s in %lld ms", entries.size(), path.c_str(), duration.count());
+                    }).detach();
+            });
+
+        PluginCommand::Register(
+            "Native Predicate Solver\\Apply Patch Plan",
+            "Apply a previously exported patch plan, skipping patches whose original bytes have changed",
+            [](BinaryView* view) {
+                std::string path;
+                if (!GetOpenFileNameInput(path, "Open patch plan", "*.npsplan"))
+                    return;
+
+                std::vector<PlanEntry> entries;
+                if (!ReadPatchPlan(path, entries)) {
+                    LogError("%s is not a valid patch plan", path.c_str());
+                    return;
+                }
+
+                Ref<BinaryView> viewRef = view;
+                std::thread([viewRef, entries = std::move(entries)]() {
+                    Ref<BackgroundTask> task = new BackgroundTask("Applying patch plan", false);
+                    task->SetProgressText("Applying " + std::to_string(entries.size()) + " planned patches");
+                    auto startTime = std::chrono::high_resolution_clock::now();
+
+                    PlanApplyResult result = ApplyPatchPlan(viewRef, entries);
+
+                    task->Finish();
+                    auto endTime = std::chrono::high_resolution_clock::now();
+                    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+                    LogInfo("[+] Applied %zu of %zu planned patches in %lld ms", result.applied, entries.size(), duration.count());
+                    if (result.bytesChanged > 0)
+                        LogWarn("[!] Skipped %zu planned patches whose original bytes changed", result.bytesChanged);
+                    if (result.unknownArchitecture > 0)
+                        LogWarn("[!] Skipped %zu planned patches for unknown architectures", result.unknownArchitecture);
+                    if (result.writeFailed > 0)
+                        LogWarn("[!] Failed to write %zu planned patches", result.writeFailed);
+                    }).detach();
+            });
+
+        PluginCommand::Register(
+            "Native Predicate Solver\\Clear Cached Verdicts",
+            "Forget stored verdicts so the next run rescans every function",
+            [](BinaryView* view) {
+                ClearCachedVerdicts(view);
+                LogInfo("[+] Cleared cached opaque predicate verdicts");
+            });
+
+        PluginCommand::Register(
+            "Native Predicate Solver\\Export Shape Templates",
+            "Save the loaded and learned expression shape templates for preloading in later sessions",
+            [](BinaryView*) {
+                std::string path;
+                if (!GetSaveFileNameInput(path, "Save shape templates", "*.npsshapes", "templates.npsshapes"))
+                    return;
+
+                int64_t count = ShapeCache::Instance().WriteTemplates(path);
+                if (count < 0) {
+                    LogError("Failed to write shape templates to %s", path.c_str());
+                    return;
+                }
+                LogInfo("[+] %lld shape templates written to %s", static_cast<long long>(count), path.c_str());
+            });
+
         return true;
     }
 
     BINARYNINJAPLUGIN void CorePluginDependencies()
     {
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,195 @@
+#include "scheduler.h"
+#include <algorithm>
+
+static constexpr uint64_t kParallelChunkCost = uint64_t(1) << 48;
+
+WorkStealingPool::WorkStealingPool(size_t threadCount)
+{
+    if (threadCount < 1)
+        threadCount = 1;
+
+    for (size_t i = 0; i < threadCount; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < threadCount; ++i)
+        m_workers[i]->thread = std::thread([this, i]() { WorkerLoop(i); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_shutdown = true;
+    }
+    m_wakeCv.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+}
+
+void WorkStealingPool::Submit(Task task, uint64_t cost)
+{
+    m_pendingTasks.fetch_add(1);
+    Push(LeastLoadedWorker(), std::move(task), cost);
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_wakeCv.notify_one();
+}
+
+void WorkStealingPool::SubmitBatch(std::vector<std::pair<uint64_t, Task>> tasks)
+{
+    if (tasks.empty())
+        return;
+
+    std::stable_sort(tasks.begin(), tasks.end(), [](const auto& a, const auto& b) {
+        return a.first > b.first;
+    });
+
+    m_pendingTasks.fetch_add(tasks.size());
+    for (auto& [cost, task] : tasks)
+        Push(LeastLoadedWorker(), std::move(task), cost);
+
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_wakeCv.notify_all();
+}
+
+void WorkStealingPool::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_idleMutex);
+    m_idleCv.wait(lock, [&] { return m_pendingTasks.load() == 0; });
+}
+
+void WorkStealingPool::ParallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body)
+{
+    if (count == 0)
+        return;
+    if (chunkSize < 1)
+        chunkSize = 1;
+
+    struct State {
+        const std::function<void(size_t, size_t)>* body;
+        size_t count;
+        size_t chunkSize;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> remaining{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    size_t chunks = (count + chunkSize - 1) / chunkSize;
+    auto state = std::make_shared<State>();
+    state->body = &body;
+    state->count = count;
+    state->chunkSize = chunkSize;
+    state->remaining.store(chunks);
+
+    // Helpers that start after the work is gone only touch the shared state,
+    // never body, so they may safely outlive this call.
+    auto runChunks = [](const std::shared_ptr<State>& state) {
+        while (true) {
+            size_t begin = state->next.fetch_add(state->chunkSize);
+            if (begin >= state->count)
+                return;
+            (*state->body)(begin, std::min(begin + state->chunkSize, state->count));
+            if (state->remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(chunks - 1, m_workers.size());
+    if (helpers != 0) {
+        std::vector<std::pair<uint64_t, Task>> tasks;
+        for (size_t i = 0; i < helpers; ++i) {
+            // Costed above any whole function so the chunks are picked up first
+            tasks.emplace_back(kParallelChunkCost, [state, runChunks]() { runChunks(state); });
+        }
+        SubmitBatch(std::move(tasks));
+    }
+
+    runChunks(state);
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->remaining.load() == 0; });
+}
+
+void WorkStealingPool::Push(size_t index, Task task, uint64_t cost)
+{
+    auto& worker = *m_workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.tasks.emplace(cost, std::move(task));
+    // Every queued task costs at least one so queues of cheap tasks still look busy
+    worker.queuedCost.fetch_add(cost + 1);
+    m_queuedTasks.fetch_add(1);
+}
+
+bool WorkStealingPool::Pop(size_t index, Task& task)
+{
+    auto& worker = *m_workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty())
+        return false;
+
+    auto it = worker.tasks.begin();
+    worker.queuedCost.fetch_sub(it->first + 1);
+    task = std::move(it->second);
+    worker.tasks.erase(it);
+    m_queuedTasks.fetch_sub(1);
+    return true;
+}
+
+bool WorkStealingPool::Steal(size_t thief, Task& task)
+{
+    // Try victims from the most to the least loaded
+    std::vector<std::pair<uint64_t, size_t>> victims;
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        if (i == thief)
+            continue;
+        uint64_t load = m_workers[i]->queuedCost.load();
+        if (load != 0)
+            victims.emplace_back(load, i);
+    }
+    std::sort(victims.begin(), victims.end(), std::greater<>());
+
+    for (auto& victim : victims) {
+        if (Pop(victim.second, task))
+            return true;
+    }
+    return false;
+}
+
+size_t WorkStealingPool::LeastLoadedWorker() const
+{
+    size_t best = 0;
+    uint64_t bestLoad = UINT64_MAX;
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        uint64_t load = m_workers[i]->queuedCost.load();
+        if (load < bestLoad) {
+            best = i;
+            bestLoad = load;
+        }
+    }
+    return best;
+}
+
+void WorkStealingPool::WorkerLoop(size_t index)
+{
+    while (true) {
+        Task task;
+        if (Pop(index, task) || Steal(index, task)) {
+            task();
+            task = nullptr;
+
+            if (m_pendingTasks.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(m_idleMutex);
+                m_idleCv.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wakeCv.wait(lock, [&] { return m_shutdown || m_queuedTasks.load() != 0; });
+        if (m_shutdown && m_queuedTasks.load() == 0)
+            break;
+    }
+}
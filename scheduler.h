@@ -0,0 +1,95 @@
+// MIT License
+//
+// Copyright (c) 2015-2024 Vector 35 Inc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef NATIVE_PREDICATE_SOLVER_SCHEDULER_H
+#define NATIVE_PREDICATE_SOLVER_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads with one cost-ordered queue per worker.
+// Each worker runs its most expensive task first and, once its own queue is
+// empty, steals the most expensive task from the busiest other worker. Running
+// the largest functions first keeps a single huge function from starting last
+// and holding up the end of a pass.
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t threadCount);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t GetThreadCount() const { return m_workers.size(); }
+
+    // Queues a single task on the worker with the least outstanding cost.
+    void Submit(Task task, uint64_t cost);
+
+    // Queues many tasks at once, dealing them out largest first so every
+    // worker starts on one of the most expensive tasks.
+    void SubmitBatch(std::vector<std::pair<uint64_t, Task>> tasks);
+
+    // Blocks until every submitted task has finished running.
+    void WaitIdle();
+
+    // Runs body(begin, end) over [0, count) in chunks of at most chunkSize.
+    // Idle workers pick up chunks while the calling thread works through them
+    // as well, so this is safe to call from inside a pool task. Returns once
+    // every chunk has finished.
+    void ParallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body);
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::multimap<uint64_t, Task, std::greater<uint64_t>> tasks;
+        std::atomic<uint64_t> queuedCost{0};
+        std::thread thread;
+    };
+
+    void Push(size_t index, Task task, uint64_t cost);
+    bool Pop(size_t index, Task& task);
+    bool Steal(size_t thief, Task& task);
+    size_t LeastLoadedWorker() const;
+    void WorkerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_pendingTasks{0};
+    std::atomic<size_t> m_queuedTasks{0};
+    bool m_shutdown = false;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCv;
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCv;
+};
+
+#endif //NATIVE_PREDICATE_SOLVER_SCHEDULER_H
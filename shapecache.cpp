@@ -0,0 +1,138 @@
+#include "shapecache.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+static constexpr const char* kShapeTemplateHeader = "# Native Predicate Solver shape templates v2";
+
+ShapeCache& ShapeCache::Instance()
+{
+    static ShapeCache cache;
+    return cache;
+}
+
+bool ShapeCache::Lookup(uint64_t shape, bool includeLearned, ShapeVerdict& verdict, ShapeSource& source)
+{
+    auto& shard = GetShard(shape);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(shape);
+    if (it == shard.entries.end())
+        return false;
+
+    const Entry& entry = it->second;
+    if (!entry.fromTemplate && !(includeLearned && !entry.conflicting && entry.observations >= kLearnThreshold))
+        return false;
+    verdict = entry.verdict;
+    source = entry.fromTemplate ? ShapeSource::Template : ShapeSource::Learned;
+    return true;
+}
+
+void ShapeCache::Learn(uint64_t shape, ShapeVerdict verdict)
+{
+    auto& shard = GetShard(shape);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.entries.try_emplace(shape);
+    Entry& entry = it->second;
+    if (entry.fromTemplate)
+        return;
+
+    if (inserted)
+        entry.verdict = verdict;
+    // One disagreement shows the verdict depends on more than the shape
+    if (entry.verdict != verdict)
+        entry.conflicting = true;
+    entry.observations++;
+}
+
+// Template files are plain text: a header line, then one
+// "<shape hash> <true|false|variable>" line per shape
+bool ShapeCache::LoadTemplates(const std::string& path)
+{
+    std::lock_guard<std::mutex> loadLock(m_loadMutex);
+    std::error_code ec;
+    auto modified = path.empty() ? std::filesystem::file_time_type() : std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return false;
+    if (path == m_loadedPath && modified == m_loadedTime)
+        return true;
+
+    std::vector<std::pair<uint64_t, ShapeVerdict>> templates;
+    std::ifstream in;
+    std::string line;
+    if (!path.empty()) {
+        in.open(path);
+        if (!std::getline(in, line) || line != kShapeTemplateHeader)
+            return false;
+    }
+    while (in.is_open() && std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        uint64_t shape = 0;
+        std::string verdict;
+        if (!(fields >> std::hex >> shape >> verdict))
+            return false;
+        if (verdict == "true") {
+            templates.emplace_back(shape, ShapeVerdict::AlwaysTrue);
+        } else if (verdict == "false") {
+            templates.emplace_back(shape, ShapeVerdict::AlwaysFalse);
+        } else if (verdict == "variable") {
+            templates.emplace_back(shape, ShapeVerdict::Variable);
+        } else {
+            return false;
+        }
+    }
+
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+            if (it->second.fromTemplate) {
+                it = shard.entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (const auto& [shape, verdict] : templates) {
+        auto& shard = GetShard(shape);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry& entry = shard.entries[shape];
+        entry = Entry();
+        entry.verdict = verdict;
+        entry.fromTemplate = true;
+    }
+    m_loadedPath = path;
+    m_loadedTime = modified;
+    return true;
+}
+
+int64_t ShapeCache::WriteTemplates(const std::string& path)
+{
+    std::ofstream out(path);
+    out << kShapeTemplateHeader << '\n';
+    int64_t count = 0;
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [shape, entry] : shard.entries) {
+            if (entry.verdict == ShapeVerdict::Variable)
+                continue;
+            if (!entry.fromTemplate && (entry.conflicting || entry.observations < kLearnThreshold))
+                continue;
+            const char* verdict = entry.verdict == ShapeVerdict::AlwaysTrue ? "true" : "false";
+            out << std::hex << shape << std::dec << ' ' << verdict << '\n';
+            count++;
+        }
+    }
+    return out ? count : -1;
+}
+
+size_t ShapeCache::GetTemplateCount()
+{
+    size_t count = 0;
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& entry : shard.entries)
+            count += entry.second.fromTemplate;
+    }
+    return count;
+}
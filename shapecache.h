@@ -0,0 +1,111 @@
+// MIT License
+//
+// Copyright (c) 2015-2024 Vector 35 Inc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef NATIVE_PREDICATE_SOLVER_SHAPECACHE_H
+#define NATIVE_PREDICATE_SOLVER_SHAPECACHE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// What a branch condition of a given shape evaluates to
+enum class ShapeVerdict : uint8_t {
+    Variable,
+    AlwaysFalse,
+    AlwaysTrue
+};
+
+// Where a verdict returned by ShapeCache::Lookup comes from
+enum class ShapeSource : uint8_t {
+    Template,
+    Learned
+};
+
+// Verdicts for branch conditions keyed by a hash of the shape of their
+// expression rather than by site, so an obfuscator template stamped across a
+// binary is decided once. Shared by every run in the process and safe to use
+// from many threads.
+//
+// Templates loaded from a file are trusted as given. Shapes can also be
+// learned from dataflow results, but that is a heuristic: dataflow may prove
+// a condition constant only because of values known at one particular site.
+// A learned shape is therefore only used once it has been seen
+// kLearnThreshold times with the same verdict and never with another one,
+// and callers keep checking a sample of its sites with dataflow.
+class ShapeCache
+{
+public:
+    static constexpr uint32_t kLearnThreshold = 16;
+    // One in this many hits on a learned shape is evaluated with dataflow
+    // anyway, so a conflicting site can still be found
+    static constexpr uint32_t kLearnedVerifyInterval = 8;
+
+    static ShapeCache& Instance();
+
+    // The trusted verdict for shape, if any. Learned shapes only count with
+    // includeLearned set.
+    bool Lookup(uint64_t shape, bool includeLearned, ShapeVerdict& verdict, ShapeSource& source);
+
+    // Notes a verdict computed by dataflow for a condition of this shape
+    void Learn(uint64_t shape, ShapeVerdict verdict);
+
+    // Replaces the templates with those in path, unless that file is
+    // unchanged since it was last loaded. An empty path drops the templates.
+    // Learned shapes are kept. Returns false if the file cannot be read.
+    bool LoadTemplates(const std::string& path);
+
+    // Writes the constant templates and every trusted constant learned shape
+    // in the format LoadTemplates reads. Variable verdicts are left out since
+    // they never spare a dataflow query. Returns the number of shapes
+    // written, or -1 if the file cannot be written.
+    int64_t WriteTemplates(const std::string& path);
+
+    size_t GetTemplateCount();
+
+private:
+    struct Entry {
+        ShapeVerdict verdict;
+        bool fromTemplate = false;
+        bool conflicting = false;
+        uint32_t observations = 0;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, Entry> entries;
+    };
+
+    static constexpr size_t kShardCount = 16;
+
+    Shard& GetShard(uint64_t shape) { return m_shards[shape % kShardCount]; }
+
+    std::array<Shard, kShardCount> m_shards;
+    std::mutex m_loadMutex;
+    std::string m_loadedPath;
+    std::filesystem::file_time_type m_loadedTime;
+};
+
+#endif //NATIVE_PREDICATE_SOLVER_SHAPECACHE_H
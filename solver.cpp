@@ -0,0 +1,1172 @@
+#include "solver.h"
+#include "core.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "hash.h"
+#include "shapecache.h"
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <set>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+using namespace BinaryNinja;
+
+static constexpr const char* kVerdictMetadataKey = "nativePredicateSolver.verdicts";
+
+// How long function-scoped reanalysis polls before waiting on the whole view
+static constexpr std::chrono::seconds kReanalyzeTimeout(30);
+
+std::string GetFunctionName(const Ref<Function>& func)
+{
+    return func->GetSymbol() ? func->GetSymbol()->GetShortName() : "sub_" + std::to_string(func->GetStart());
+}
+
+// A conditional branch in MLIL, identified by the MLIL_IF that ends its block
+struct BranchSite {
+    uint64_t address;
+    size_t conditionExpr;
+};
+
+// An IF can only terminate a basic block, and such a block is the only kind
+// with a true/false edge pair, so only the terminators of conditional blocks
+// are materialised. Works on both LLIL and MLIL.
+template <typename ILFunction, typename Operation>
+static std::vector<BranchSite> CollectBranchSites(const Ref<ILFunction>& il, Operation ifOperation)
+{
+    std::vector<BranchSite> sites;
+    for (auto& block : il->GetBasicBlocks()) {
+        if (block->GetEnd() <= block->GetStart())
+            continue;
+
+        bool hasTrue = false;
+        bool hasFalse = false;
+        for (auto& edge : block->GetOutgoingEdges()) {
+            hasTrue |= edge.type == TrueBranch;
+            hasFalse |= edge.type == FalseBranch;
+        }
+        if (!hasTrue || !hasFalse)
+            continue;
+
+        auto instr = il->GetInstruction(block->GetEnd() - 1);
+        if (instr.operation != ifOperation)
+            continue;
+        sites.push_back({instr.address, instr.GetConditionExpr().exprIndex});
+    }
+    return sites;
+}
+
+// Whether any native block of func ends in a conditional branch. Functions
+// without one cannot contain an opaque predicate, whatever their IL says.
+static bool HasConditionalBranch(const Ref<Function>& func)
+{
+    for (auto& block : func->GetBasicBlocks()) {
+        for (auto& edge : block->GetOutgoingEdges()) {
+            if (edge.type == TrueBranch || edge.type == FalseBranch)
+                return true;
+        }
+    }
+    return false;
+}
+
+// Appends a patch for a branch at address whose condition evaluated to value,
+// if the value is constant and the branch can be patched
+static void CheckConstantBranch(const Ref<BinaryView>& viewRef, const Ref<Architecture>& arch, uint64_t address, const RegisterValue& value,
+                                std::vector<SolverPatch>& patches)
+{
+    if (value.state != BNRegisterValueType::ConstantValue)
+        return;
+
+    if (value.value == 0) {
+        if (viewRef->IsNeverBranchPatchAvailable(arch, address)) {
+            patches.push_back({address, false});
+        }
+    }
+    else {
+        if (viewRef->IsAlwaysBranchPatchAvailable(arch, address)) {
+            patches.push_back({address, true});
+        }
+    }
+}
+
+// SSA definitions followed from a branch condition when hashing its shape
+static constexpr size_t kShapeDefinitionDepth = 4;
+
+// Hash of the shape of a branch condition: operations, sizes, constants and
+// how the operands nest. The condition of an MLIL_IF is usually a shallow
+// compare of a variable, with the interesting arithmetic in the assignments
+// before it, so the hash is taken on the SSA form and variables are replaced
+// by the expressions that define them, up to kShapeDefinitionDepth
+// definitions deep. Variables that are not expanded (parameters, phis, call
+// results, or anything past the depth limit) are numbered in order of first
+// use, so x * (x + 1) and y * (y + 1) share a shape while x * (y + 1) does not.
+static uint64_t HashExpressionShape(const Ref<MediumLevelILFunction>& mlil, size_t exprIndex)
+{
+    Fnv1aHash hash;
+    Ref<MediumLevelILFunction> ssa = mlil->GetSSAForm();
+    if (!ssa)
+        return hash.Get();
+
+    std::map<std::pair<uint64_t, size_t>, uint32_t> variables;
+    std::function<void(const MediumLevelILInstruction&, size_t)> visit;
+    auto addVariable = [&](const SSAVariable& var, size_t depth) {
+        auto [it, inserted] = variables.try_emplace({var.var.ToIdentifier(), var.version}, static_cast<uint32_t>(variables.size()));
+        hash.AddValue(it->second);
+        if (!inserted || depth >= kShapeDefinitionDepth)
+            return;
+
+        // A variable used twice is expanded once and referenced by number after
+        size_t definition = ssa->GetSSAVarDefinition(var);
+        if (definition >= ssa->GetInstructionCount())
+            return;
+        auto instr = ssa->GetInstruction(definition);
+        if (instr.operation != MLIL_SET_VAR_SSA)
+            return;
+        for (const auto& operand : instr.GetOperands()) {
+            if (operand.GetType() == ExprMediumLevelOperand)
+                visit(operand.GetExpr(), depth + 1);
+        }
+    };
+
+    visit = [&](const MediumLevelILInstruction& expr, size_t depth) {
+        hash.AddValue(expr.operation);
+        hash.AddValue(expr.size);
+        for (const auto& operand : expr.GetOperands()) {
+            auto type = operand.GetType();
+            hash.AddValue(type);
+            switch (type) {
+            case IntegerMediumLevelOperand:
+                hash.AddValue(operand.GetInteger());
+                break;
+            case IndexMediumLevelOperand:
+            case IntrinsicMediumLevelOperand:
+                hash.AddValue(operand.GetIndex());
+                break;
+            case ExprMediumLevelOperand:
+                visit(operand.GetExpr(), depth);
+                break;
+            case VariableMediumLevelOperand:
+                addVariable({operand.GetVariable(), 0}, kShapeDefinitionDepth);
+                break;
+            case SSAVariableMediumLevelOperand:
+                addVariable(operand.GetSSAVariable(), depth);
+                break;
+            case ExprListMediumLevelOperand:
+                for (const auto& item : operand.GetExprList())
+                    visit(item, depth);
+                break;
+            case VariableListMediumLevelOperand:
+                for (const auto& var : operand.GetVariableList())
+                    addVariable({var, 0}, kShapeDefinitionDepth);
+                break;
+            case SSAVariableListMediumLevelOperand:
+                for (const auto& var : operand.GetSSAVariableList())
+                    addVariable(var, depth);
+                break;
+            default:
+                // Anything else only contributes its operand type
+                break;
+            }
+        }
+    };
+    visit(ssa->GetExpr(mlil->GetSSAExprIndex(exprIndex)), 0);
+    return hash.Get();
+}
+
+// How a scan uses the shared ShapeCache, and how often the cache answered
+struct ShapeCacheSession {
+    bool enabled = false;
+    bool learn = false;
+    std::atomic<size_t> lookups{0};
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> learnedHits{0};
+};
+
+// Reads the shape cache settings and loads the template file they name
+static void ConfigureShapeCache(const Ref<BinaryView>& viewRef, ShapeCacheSession& session)
+{
+    auto settings = Settings::Instance();
+    std::string mode = settings->Get<std::string>("nativePredicateSolver.shapeCache", viewRef);
+    if (mode == "off")
+        return;
+
+    auto& cache = ShapeCache::Instance();
+    std::string path = settings->Get<std::string>("nativePredicateSolver.shapeTemplateFile", viewRef);
+    if (!cache.LoadTemplates(path))
+        LogWarn("[!] Failed to load shape templates from %s", path.c_str());
+    session.learn = mode == "learn";
+    session.enabled = session.learn || cache.GetTemplateCount() != 0;
+}
+
+// Appends a patch for each of the given sites whose condition is constant and
+// can be patched. With a shape cache session, conditions whose shape matches
+// a template skip the dataflow query. Learned shapes only skip it for
+// constant verdicts, and not on every site: a learned Variable verdict would
+// hide any opaque predicate of the same shape, and checking a sample of the
+// constant ones lets a conflicting site still mark the shape as unreliable.
+static void EvaluateBranchSites(const Ref<BinaryView>& viewRef, const Ref<MediumLevelILFunction>& mlil, const Ref<Architecture>& arch,
+                                const std::vector<BranchSite>& sites, size_t begin, size_t end, const ScanContext& ctx,
+                                ShapeCacheSession* shapes, std::vector<SolverPatch>& patches)
+{
+    for (size_t i = begin; i < end; ++i) {
+        if ((i - begin) % 100 == 0 && ctx.isCancelled()) {
+            break;
+        }
+
+        const auto& site = sites[i];
+        uint64_t shape = 0;
+        if (shapes && shapes->enabled) {
+            PhaseTimer timer(ctx.stats, SolverPhase::ShapeLookup);
+            shape = HashExpressionShape(mlil, site.conditionExpr);
+            ShapeVerdict verdict;
+            ShapeSource source;
+            shapes->lookups.fetch_add(1);
+            // A variable verdict never skips dataflow: the condition may still
+            // be constant at this site, and skipping it would hide a predicate
+            bool cached = ShapeCache::Instance().Lookup(shape, shapes->learn, verdict, source)
+                && verdict != ShapeVerdict::Variable;
+            if (cached && source == ShapeSource::Learned)
+                cached = shapes->learnedHits.fetch_add(1) % ShapeCache::kLearnedVerifyInterval != 0;
+            if (cached) {
+                shapes->hits.fetch_add(1);
+                RegisterValue val;
+                val.state = BNRegisterValueType::ConstantValue;
+                val.value = verdict == ShapeVerdict::AlwaysTrue ? 1 : 0;
+                PhaseTimer checkTimer(ctx.stats, SolverPhase::PatchCheck);
+                CheckConstantBranch(viewRef, arch, site.address, val, patches);
+                continue;
+            }
+        }
+
+        RegisterValue val;
+        {
+            PhaseTimer timer(ctx.stats, SolverPhase::ExprValue);
+            val = mlil->GetExprValue(site.conditionExpr);
+        }
+        bool constant = val.state == BNRegisterValueType::ConstantValue;
+        if (shapes && shapes->learn) {
+            ShapeCache::Instance().Learn(shape, !constant ? ShapeVerdict::Variable
+                                                : val.value != 0 ? ShapeVerdict::AlwaysTrue : ShapeVerdict::AlwaysFalse);
+        }
+        if (constant) {
+            PhaseTimer timer(ctx.stats, SolverPhase::PatchCheck);
+            CheckConstantBranch(viewRef, arch, site.address, val, patches);
+        }
+    }
+}
+
+// Fingerprint of a function's code: its basic-block layout, the edges between
+// the blocks and the bytes they cover. A function whose fingerprint matches
+// the one stored after its last scan cannot contain anything new to patch.
+static uint64_t ComputeFunctionFingerprint(const Ref<BinaryView>& viewRef, const Ref<Function>& func)
+{
+    auto blocks = func->GetBasicBlocks();
+    std::sort(blocks.begin(), blocks.end(), [](const Ref<BasicBlock>& a, const Ref<BasicBlock>& b) {
+        return a->GetStart() < b->GetStart();
+    });
+
+    Fnv1aHash hash;
+    std::vector<uint8_t> bytes;
+    for (auto& block : blocks) {
+        uint64_t start = block->GetStart();
+        uint64_t end = block->GetEnd();
+        hash.AddValue(start);
+        hash.AddValue(end);
+        for (auto& edge : block->GetOutgoingEdges()) {
+            hash.AddValue(edge.type);
+            hash.AddValue(edge.target ? edge.target->GetStart() : 0);
+        }
+
+        bytes.resize(end > start ? end - start : 0);
+        size_t length = viewRef->Read(bytes.data(), start, bytes.size());
+        hash.Add(bytes.data(), length);
+    }
+    return hash.Get();
+}
+
+// Assembles the given patches into copies of the original instructions with
+// the architecture's own AlwaysBranch and ConvertToNop, as the view's
+// methods of the same names would, and writes each run of back-to-back
+// instructions within a segment with a single Write. Returns the number of
+// patches written.
+static size_t WritePatches(const Ref<BinaryView>& viewRef, const Ref<Architecture>& arch, std::vector<SolverPatch> patches)
+{
+    std::sort(patches.begin(), patches.end(), [](const SolverPatch& a, const SolverPatch& b) {
+        return a.address < b.address;
+    });
+
+    size_t written = 0;
+    size_t pending = 0;
+    uint64_t runStart = 0;
+    Ref<Segment> runSegment;
+    std::vector<uint8_t> run;
+    auto flush = [&]() {
+        if (!run.empty() && viewRef->Write(runStart, run.data(), run.size()) == run.size())
+            written += pending;
+        run.clear();
+        pending = 0;
+    };
+
+    size_t maxLength = arch->GetMaxInstructionLength();
+    std::vector<uint8_t> bytes(maxLength);
+    for (const auto& patch : patches) {
+        size_t read = viewRef->Read(bytes.data(), patch.address, maxLength);
+        InstructionInfo info;
+        if (read == 0 || !arch->GetInstructionInfo(bytes.data(), patch.address, read, info) || info.length == 0 || info.length > read)
+            continue;
+
+        bool assembled = patch.alwaysBranch ? arch->AlwaysBranch(bytes.data(), patch.address, info.length)
+                                            : arch->ConvertToNop(bytes.data(), patch.address, info.length);
+        if (!assembled)
+            continue;
+
+        // Each lookup returns a new wrapper, so segments are compared by start.
+        // Bytes outside any segment are written one patch at a time.
+        Ref<Segment> segment = viewRef->GetSegmentAt(patch.address);
+        bool sameSegment = segment && runSegment && segment->GetStart() == runSegment->GetStart();
+        if (run.empty() || runStart + run.size() != patch.address || !sameSegment) {
+            flush();
+            runStart = patch.address;
+            runSegment = segment;
+        }
+        run.insert(run.end(), bytes.begin(), bytes.begin() + info.length);
+        pending++;
+    }
+    flush();
+    return written;
+}
+
+// SolverBackend on a live BinaryView. Branches are found in MLIL and
+// evaluated with the MLIL dataflow; patches go through the view's own
+// AlwaysBranch and ConvertToNop.
+class BinaryViewBackend : public SolverBackend
+{
+public:
+    explicit BinaryViewBackend(Ref<BinaryView> viewRef)
+        : m_view(viewRef), m_tieredEvaluation(Settings::Instance()->Get<bool>("nativePredicateSolver.tieredEvaluation", viewRef))
+    {
+    }
+
+    // Reads the shape cache settings for this run. Backends that only write
+    // patches leave it off and never touch the template file.
+    void EnableShapeCache()
+    {
+        ConfigureShapeCache(m_view, m_shapes);
+    }
+
+    static SolverFunctionRef Wrap(const Ref<Function>& func) { return std::make_shared<ViewFunction>(func); }
+    static Ref<Function> Unwrap(const SolverFunctionRef& func) { return static_cast<const ViewFunction&>(*func).func; }
+
+    std::vector<SolverFunctionRef> GetFunctions() override
+    {
+        std::vector<SolverFunctionRef> result;
+        for (auto& func : m_view->GetAnalysisFunctionList())
+            result.push_back(Wrap(func));
+        return result;
+    }
+
+    // Walks function starts from the view rather than taking the full
+    // function list, so a window only ever holds its own functions
+    std::vector<SolverFunctionRef> GetFunctionWindow(uint64_t start, uint64_t maxCost) override
+    {
+        std::vector<SolverFunctionRef> result;
+        uint64_t cost = 0;
+        auto add = [&](uint64_t address) {
+            for (auto& func : m_view->GetAnalysisFunctionsForAddress(address)) {
+                result.push_back(Wrap(func));
+                cost += EstimateCost(result.back());
+            }
+        };
+
+        uint64_t address = std::max(start, m_view->GetStart());
+        add(address);
+        while (cost < maxCost) {
+            uint64_t next = m_view->GetNextFunctionStartAfterAddress(address);
+            if (next <= address || next >= m_view->GetEnd())
+                break;
+            address = next;
+            add(address);
+        }
+        return result;
+    }
+
+    // Nothing is kept per function between scans; the functions keep their
+    // IL until Binary Ninja's analysis cache lets go of it
+    void ReleaseFunctions(const std::vector<SolverFunctionRef>&) override
+    {
+    }
+
+    SolverFunctionRef Refresh(const SolverFunctionRef& func) override
+    {
+        auto current = Unwrap(func);
+        auto updated = m_view->GetAnalysisFunction(current->GetPlatform(), current->GetStart());
+        return updated ? Wrap(updated) : nullptr;
+    }
+
+    // Native extent at roughly four bytes per MLIL instruction
+    uint64_t EstimateCost(const SolverFunctionRef& func) override
+    {
+        auto current = Unwrap(func);
+        uint64_t start = current->GetStart();
+        uint64_t highest = current->GetHighestAddress();
+        return highest > start ? (highest - start) / 4 : 1;
+    }
+
+    // With tiered evaluation MLIL is only generated for functions that have
+    // a conditional branch LLIL could not resolve, and only those branches are
+    // evaluated in MLIL
+    std::vector<SolverPatch> ScanFunction(const SolverFunctionRef& func, const ScanContext& ctx, size_t& instructionCount) override
+    {
+        instructionCount = 0;
+        auto current = Unwrap(func);
+        auto arch = current->GetArchitecture();
+        if (!arch)
+            return {};
+        m_scans.fetch_add(1);
+
+        std::vector<SolverPatch> patches;
+        std::set<uint64_t> unresolved;
+        bool filtered = false;
+        if (m_tieredEvaluation) {
+            PhaseTimer timer(ctx.stats, SolverPhase::Prefilter);
+            if (!HasConditionalBranch(current)) {
+                m_withoutBranches.fetch_add(1);
+                instructionCount = EstimateCost(func);
+                return patches;
+            }
+
+            Ref<LowLevelILFunction> llil = current->GetLowLevelIL();
+            if (llil) {
+                for (const auto& site : CollectBranchSites(llil, LLIL_IF)) {
+                    RegisterValue value = llil->GetExprValue(site.conditionExpr);
+                    if (value.state == BNRegisterValueType::ConstantValue) {
+                        CheckConstantBranch(m_view, arch, site.address, value, patches);
+                    } else {
+                        unresolved.insert(site.address);
+                    }
+                }
+                if (unresolved.empty()) {
+                    m_resolvedInLowLevelIL.fetch_add(1);
+                    instructionCount = llil->GetInstructionCount();
+                    return patches;
+                }
+                filtered = true;
+            }
+        }
+
+        Ref<MediumLevelILFunction> mlil;
+        {
+            PhaseTimer timer(ctx.stats, SolverPhase::MediumLevelIL);
+            mlil = current->GetMediumLevelIL();
+        }
+        if (!mlil || mlil->GetInstructionCount() == 0)
+            return patches;
+        instructionCount = mlil->GetInstructionCount();
+
+        auto sites = CollectBranchSites(mlil, MLIL_IF);
+        if (filtered) {
+            sites.erase(std::remove_if(sites.begin(), sites.end(), [&](const BranchSite& site) {
+                return unresolved.count(site.address) == 0;
+            }), sites.end());
+        }
+
+        auto mlilPatches = EvaluateSites(ctx, instructionCount, sites.size(), [&](size_t begin, size_t end, std::vector<SolverPatch>& slice) {
+            EvaluateBranchSites(m_view, mlil, arch, sites, begin, end, ctx, &m_shapes, slice);
+        });
+        patches.insert(patches.end(), mlilPatches.begin(), mlilPatches.end());
+        return patches;
+    }
+
+    // How many scans the tiers saved from generating MLIL
+    void LogTierSummary() const
+    {
+        if (!m_tieredEvaluation || m_scans.load() == 0)
+            return;
+        LogInfo("[+] Tiered evaluation: %zu of %zu scans needed no MLIL (%zu without conditional branches, %zu resolved in LLIL)",
+                m_withoutBranches.load() + m_resolvedInLowLevelIL.load(), m_scans.load(), m_withoutBranches.load(), m_resolvedInLowLevelIL.load());
+    }
+
+    // How often the shape cache saved a dataflow query
+    void LogShapeSummary() const
+    {
+        if (!m_shapes.enabled || m_shapes.lookups.load() == 0)
+            return;
+        LogInfo("[+] Shape cache: %zu of %zu branch conditions decided by shape (%.1f%%)", m_shapes.hits.load(), m_shapes.lookups.load(),
+                100.0 * m_shapes.hits.load() / m_shapes.lookups.load());
+    }
+
+    uint64_t ComputeFingerprint(const SolverFunctionRef& func) override
+    {
+        return ComputeFunctionFingerprint(m_view, Unwrap(func));
+    }
+
+    size_t ApplyPatches(const SolverFunctionRef& func, const std::vector<SolverPatch>& patches) override
+    {
+        auto arch = Unwrap(func)->GetArchitecture();
+        return arch ? WritePatches(m_view, arch, patches) : 0;
+    }
+
+    void BeginPatchGroup() override
+    {
+        m_undoId = m_view->BeginUndoActions();
+    }
+
+    void EndPatchGroup() override
+    {
+        m_view->CommitUndoActions(m_undoId);
+        m_undoId.clear();
+    }
+
+    std::vector<SolverFunctionRef> GetCallees(const SolverFunctionRef& func) override
+    {
+        std::set<BNFunction*> seen;
+        std::vector<SolverFunctionRef> result;
+        ForEachCallee(Unwrap(func), [&](const Ref<Function>& callee) {
+            if (seen.insert(callee->GetObject()).second)
+                result.push_back(Wrap(callee));
+        });
+        return result;
+    }
+
+    std::vector<SolverFunctionRef> GetAffectedFunctions(const SolverFunctionRef& func, const std::vector<SolverPatch>& patches) override
+    {
+        std::vector<Ref<Function>> affected = {Unwrap(func)};
+        for (const auto& patch : patches) {
+            for (auto& other : m_view->GetAnalysisFunctionsContainingAddress(patch.address)) {
+                bool known = std::any_of(affected.begin(), affected.end(), [&](const Ref<Function>& f) {
+                    return f->GetObject() == other->GetObject();
+                });
+                if (!known)
+                    affected.push_back(other);
+            }
+        }
+
+        std::vector<SolverFunctionRef> result;
+        for (auto& f : affected)
+            result.push_back(Wrap(f));
+        return result;
+    }
+
+    // With functionScope the cost follows the size of the patched code rather
+    // than the size of the binary
+    void Reanalyze(const std::vector<SolverFunctionRef>& functions, bool functionScope, const std::function<bool()>& isCancelled) override
+    {
+        if (!functionScope) {
+            m_view->UpdateAnalysisAndWait();
+            return;
+        }
+
+        std::vector<Ref<Function>> pending;
+        for (auto& func : functions) {
+            pending.push_back(Unwrap(func));
+            pending.back()->Reanalyze();
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + kReanalyzeTimeout;
+        auto delay = std::chrono::milliseconds(1);
+        while (!isCancelled()) {
+            bool needsUpdate = std::any_of(pending.begin(), pending.end(), [](const Ref<Function>& func) {
+                return func->NeedsUpdate();
+            });
+            if (!needsUpdate)
+                break;
+            if (std::chrono::steady_clock::now() >= deadline) {
+                LogWarn("[!] Function reanalysis timed out, waiting for the whole view");
+                m_view->UpdateAnalysisAndWait();
+                break;
+            }
+            std::this_thread::sleep_for(delay);
+            delay = std::min(delay * 2, std::chrono::milliseconds(20));
+        }
+    }
+
+    void UpdateAnalysis() override
+    {
+        m_view->UpdateAnalysisAndWait();
+    }
+
+    std::vector<SolverFunctionRef> GetDirtyFunctions(const std::set<uint64_t>& patchedFunctions, const std::set<uint64_t>& patchAddresses) override
+    {
+        // Ref wrappers are created per call, so functions are told apart by
+        // their core handles
+        std::set<BNFunction*> seen;
+        std::vector<SolverFunctionRef> result;
+        auto addFunction = [&](const Ref<Function>& func) {
+            if (func && seen.insert(func->GetObject()).second)
+                result.push_back(Wrap(func));
+        };
+
+        // Every function sharing a patched instruction sees the new bytes
+        for (uint64_t address : patchAddresses) {
+            for (auto& func : m_view->GetAnalysisFunctionsContainingAddress(address))
+                addFunction(func);
+        }
+
+        for (uint64_t start : patchedFunctions) {
+            for (auto& func : m_view->GetAnalysisFunctionsForAddress(start)) {
+                addFunction(func);
+
+                // Callers may now see different return values or side effects
+                for (auto& caller : m_view->GetCallers(start))
+                    addFunction(caller.func);
+
+                // Callees may have gained (or lost) call sites and arguments
+                ForEachCallee(func, addFunction);
+            }
+        }
+        return result;
+    }
+
+    std::string LoadVerdicts() override
+    {
+        auto metadata = m_view->QueryMetadata(kVerdictMetadataKey);
+        if (!metadata || !metadata->IsString())
+            return "";
+        return metadata->GetString();
+    }
+
+    void StoreVerdicts(const std::string& verdicts) override
+    {
+        m_view->StoreMetadata(kVerdictMetadataKey, new Metadata(verdicts));
+    }
+
+    void Log(SolverLogLevel level, const std::string& message) override
+    {
+        if (level == SolverLogLevel::Warning) {
+            LogWarn("%s", message.c_str());
+        } else {
+            LogInfo("%s", message.c_str());
+        }
+    }
+
+private:
+    struct ViewFunction : public SolverFunction {
+        explicit ViewFunction(Ref<Function> func) : func(func) {}
+        uint64_t GetStart() const override { return func->GetStart(); }
+        Ref<Function> func;
+    };
+
+    // Calls callback for every function called from func, once per call site
+    template <typename Callback>
+    void ForEachCallee(const Ref<Function>& func, Callback callback)
+    {
+        for (auto& callSite : func->GetCallSites()) {
+            for (uint64_t target : m_view->GetCallees(callSite)) {
+                for (auto& callee : m_view->GetAnalysisFunctionsForAddress(target))
+                    callback(callee);
+            }
+        }
+    }
+
+    Ref<BinaryView> m_view;
+    bool m_tieredEvaluation;
+    ShapeCacheSession m_shapes;
+    std::string m_undoId;
+    std::atomic<size_t> m_scans{0};
+    std::atomic<size_t> m_withoutBranches{0};
+    std::atomic<size_t> m_resolvedInLowLevelIL{0};
+};
+
+static constexpr const char* kInlineActivityName = "extension.nativePredicateSolver.resolvePredicates";
+
+// Applies the patches found by the analysis activity. Writing from inside the
+// activity would change the function while it is being analysed, so the
+// writes go to a worker thread, which then marks the patched functions for
+// reanalysis. The activity runs again on the new MLIL within the same
+// analysis update, so predicates uncovered by a patch are resolved without a
+// global pass. Rounds are counted per function to honour
+// maxPassesPerFunction, and forgotten when the view is closed together with
+// the view's shape cache session.
+class InlinePatchQueue
+{
+public:
+    static InlinePatchQueue& Instance()
+    {
+        static InlinePatchQueue queue;
+        return queue;
+    }
+
+    void Submit(const Ref<BinaryView>& viewRef, const Ref<Function>& func, std::vector<SolverPatch> patches, int maxRounds)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& viewRounds = m_rounds[viewRef->GetObject()];
+            if (patches.empty()) {
+                viewRounds.erase(func->GetStart());
+                return;
+            }
+
+            int rounds = ++viewRounds[func->GetStart()];
+            if (rounds > maxRounds) {
+                if (rounds == maxRounds + 1)
+                    LogWarn("[!] %s still has opaque predicates after %d inline rounds", GetFunctionName(func).c_str(), maxRounds);
+                return;
+            }
+        }
+
+        WorkerEnqueue([viewRef, func, patches = std::move(patches)]() {
+            BinaryViewBackend backend(viewRef);
+            auto wrapped = BinaryViewBackend::Wrap(func);
+            size_t written = backend.ApplyPatches(wrapped, patches);
+            if (written == 0)
+                return;
+            for (auto& affected : backend.GetAffectedFunctions(wrapped, patches))
+                BinaryViewBackend::Unwrap(affected)->Reanalyze();
+            LogDebug("Inline analysis patched %zu opaque predicates in %s", written, GetFunctionName(func).c_str());
+        }, "Native Predicate Solver");
+    }
+
+    // The shape cache session of the activity for this view, configured the
+    // first time it is needed rather than for every function analysed
+    std::shared_ptr<ShapeCacheSession> GetShapeSession(const Ref<BinaryView>& viewRef)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& session = m_shapeSessions[viewRef->GetObject()];
+        if (!session) {
+            session = std::make_shared<ShapeCacheSession>();
+            ConfigureShapeCache(viewRef, *session);
+        }
+        return session;
+    }
+
+    // Drops the round counts and shape session of a view that is being
+    // closed, so a view allocated at the same address later starts afresh
+    void Forget(BNBinaryView* view)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rounds.erase(view);
+        m_shapeSessions.erase(view);
+    }
+
+private:
+    std::mutex m_mutex;
+    // Keyed by the core view handle: every Ref<BinaryView> handed to the
+    // activity or the finalization event is a new wrapper around it
+    std::map<BNBinaryView*, std::map<uint64_t, int>> m_rounds;
+    std::map<BNBinaryView*, std::shared_ptr<ShapeCacheSession>> m_shapeSessions;
+};
+
+static void ResolvePredicatesActivity(Ref<AnalysisContext> analysisContext)
+{
+    Ref<Function> func = analysisContext->GetFunction();
+    Ref<BinaryView> viewRef = func ? func->GetView() : nullptr;
+    if (!viewRef)
+        return;
+
+    auto settings = Settings::Instance();
+    if (!settings->Get<bool>("nativePredicateSolver.inlineAnalysis", viewRef))
+        return;
+
+    Ref<MediumLevelILFunction> mlil = analysisContext->GetMediumLevelILFunction();
+    auto arch = func->GetArchitecture();
+    if (!mlil || !arch)
+        return;
+
+    auto sites = CollectBranchSites(mlil, MLIL_IF);
+    ScanContext scanContext = {nullptr, 0, []() { return false; }, nullptr};
+    auto shapes = InlinePatchQueue::Instance().GetShapeSession(viewRef);
+    std::vector<SolverPatch> patches;
+    EvaluateBranchSites(viewRef, mlil, arch, sites, 0, sites.size(), scanContext, shapes.get(), patches);
+
+    int maxRounds = static_cast<int>(settings->Get<int64_t>("nativePredicateSolver.maxPassesPerFunction", viewRef));
+    InlinePatchQueue::Instance().Submit(viewRef, func, std::move(patches), maxRounds);
+}
+
+void RegisterSolverWorkflow()
+{
+    // The activity goes into the default function workflow, between MLIL and
+    // HLIL generation, and does nothing unless inlineAnalysis is enabled
+    Ref<Workflow> workflow = Workflow::Instance("core.function.metaAnalysis")->Clone("core.function.metaAnalysis");
+    workflow->RegisterActivity(new Activity(R"~({
+        "name": "extension.nativePredicateSolver.resolvePredicates",
+        "title": "Resolve Opaque Predicates",
+        "description": "Patches conditional branches whose MLIL condition is constant as each function is analysed."
+    })~", &ResolvePredicatesActivity));
+    workflow->Insert("core.function.generateHighLevelIL", kInlineActivityName);
+    Workflow::RegisterWorkflow(workflow);
+
+    BinaryViewEvent::RegisterBinaryViewEvent(BinaryViewFinalizationEvent, [](Ref<BinaryView> view) {
+        InlinePatchQueue::Instance().Forget(view->GetObject());
+    });
+}
+
+static constexpr const char* kPatchPlanHeader = "# Native Predicate Solver patch plan v1";
+
+static uint64_t HashBytes(const Ref<BinaryView>& viewRef, uint64_t address, size_t length)
+{
+    std::vector<uint8_t> bytes(length);
+    size_t read = viewRef->Read(bytes.data(), address, length);
+    Fnv1aHash hash;
+    hash.AddValue(read);
+    hash.Add(bytes.data(), read);
+    return hash.Get();
+}
+
+static bool MakePlanEntry(const Ref<BinaryView>& viewRef, const Ref<Architecture>& arch, const SolverPatch& patch, PlanEntry& entry)
+{
+    if (!arch)
+        return false;
+    size_t maxLength = arch->GetMaxInstructionLength();
+    std::vector<uint8_t> bytes(maxLength);
+    size_t read = viewRef->Read(bytes.data(), patch.address, maxLength);
+
+    InstructionInfo info;
+    if (!arch->GetInstructionInfo(bytes.data(), patch.address, read, info) || info.length == 0)
+        return false;
+
+    entry = {arch->GetName(), patch.address, patch.alwaysBranch, info.length, HashBytes(viewRef, patch.address, info.length)};
+    return true;
+}
+
+// Plan files are plain text: a header line, then one
+// "<arch> <address> <j|n> <length> <bytes hash>" line per patch
+bool WritePatchPlan(const std::string& path, const std::vector<PlanEntry>& entries)
+{
+    std::ofstream out(path);
+    out << kPatchPlanHeader << '\n';
+    for (const auto& entry : entries) {
+        out << entry.arch << ' ' << std::hex << entry.address << ' ' << (entry.alwaysBranch ? 'j' : 'n') << ' '
+            << std::dec << entry.length << ' ' << std::hex << entry.bytesHash << std::dec << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+bool ReadPatchPlan(const std::string& path, std::vector<PlanEntry>& entries)
+{
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line) || line != kPatchPlanHeader)
+        return false;
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        PlanEntry entry;
+        char kind = 0;
+        if (!(fields >> entry.arch >> std::hex >> entry.address >> kind >> std::dec >> entry.length >> std::hex >> entry.bytesHash))
+            return false;
+        entry.alwaysBranch = kind == 'j';
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+void WriteRunReport(const Ref<BinaryView>& viewRef, const RunStats& stats, const std::string& command, size_t threadCount,
+                    std::chrono::nanoseconds elapsed)
+{
+    auto settings = Settings::Instance();
+    if (!settings->Get<bool>("nativePredicateSolver.writeReport", viewRef))
+        return;
+
+    std::filesystem::path source(viewRef->GetFile()->GetFilename());
+    std::string directory = settings->Get<std::string>("nativePredicateSolver.reportDirectory", viewRef);
+    std::filesystem::path path = directory.empty() ? source.parent_path() : std::filesystem::path(directory);
+    path /= source.filename().string() + ".predicate-solver.json";
+
+    auto nameForFunction = [&](uint64_t start) -> std::string {
+        auto functions = viewRef->GetAnalysisFunctionsForAddress(start);
+        return functions.empty() ? "sub_" + std::to_string(start) : GetFunctionName(functions[0]);
+    };
+    uint64_t totalNanoseconds = elapsed.count();
+
+    std::ofstream out(path);
+    out << stats.ToJson(command, threadCount, totalNanoseconds, kReportSlowestFunctions, nameForFunction);
+    if (!out) {
+        LogWarn("Failed to write performance report to %s", path.string().c_str());
+        return;
+    }
+    LogInfo("[+] Performance report written to %s", path.string().c_str());
+}
+
+// Rough resident size of one MLIL instruction with its SSA form and
+// dataflow, used to turn the streaming memory budget into scan cost
+static constexpr uint64_t kEstimatedBytesPerInstruction = 1024;
+
+SolverOptions GetSolverOptions(const Ref<BinaryView>& viewRef)
+{
+    auto settings = Settings::Instance();
+    SolverOptions options;
+    options.maxPassesPerFunction = static_cast<int>(settings->Get<int64_t>("nativePredicateSolver.maxPassesPerFunction", viewRef));
+    options.maxGlobalPasses = static_cast<int>(settings->Get<int64_t>("nativePredicateSolver.maxGlobalPasses", viewRef));
+    options.threadCount = static_cast<int>(settings->Get<int64_t>("nativePredicateSolver.threadCount", viewRef));
+    if (options.threadCount < 1) options.threadCount = 1;
+    options.incrementalGlobalPasses = settings->Get<bool>("nativePredicateSolver.incrementalGlobalPasses", viewRef);
+    options.functionScopedReanalysis = settings->Get<std::string>("nativePredicateSolver.reanalysisScope", viewRef) == "function";
+    options.parallelScanThreshold = static_cast<size_t>(settings->Get<int64_t>("nativePredicateSolver.parallelScanThreshold", viewRef));
+    options.verdictCache = settings->Get<bool>("nativePredicateSolver.verdictCache", viewRef);
+    options.singleUndoAction = settings->Get<std::string>("nativePredicateSolver.undoGrouping", viewRef) == "run";
+    options.reachableDepth = static_cast<size_t>(std::max<int64_t>(0, settings->Get<int64_t>("nativePredicateSolver.reachableDepth", viewRef)));
+    int64_t budgetMegabytes = settings->Get<int64_t>("nativePredicateSolver.streamingMemoryBudget", viewRef);
+    if (budgetMegabytes > 0)
+        options.streamingWindowCost = static_cast<uint64_t>(budgetMegabytes) * 1024 * 1024 / kEstimatedBytesPerInstruction;
+    return options;
+}
+
+void RegisterSolverSettings()
+{
+    auto settings = Settings::Instance();
+    settings->RegisterGroup("nativePredicateSolver", "Native Predicate Solver");
+    settings->RegisterSetting("nativePredicateSolver.maxPassesPerFunction",
+        R"~({
+                        "title": "Max passes per function",
+                        "type": "number",
+                        "default": 10,
+                        "description": "Maximum number of passes to run when patching opaque predicates in a single function."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.maxGlobalPasses",
+        R"~({
+                        "title": "Max global passes",
+                        "type": "number",
+                        "default": 20,
+                        "description": "Maximum number of global passes when patching all functions in the binary."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.threadCount",
+        R"~({
+                        "title": "Thread count",
+                        "type": "number",
+                        "default": 8,
+                        "description": "Number of threads to use when patching opaque predicates. Recommended: number of CPU cores."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.reachableDepth",
+        R"~({
+                        "title": "Reachable call depth",
+                        "type": "number",
+                        "default": 8,
+                        "minValue": 0,
+                        "description": "How many calls deep the reachable functions command follows the call graph from the current function. Callees uncovered by patches are added as they appear."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.incrementalGlobalPasses",
+        R"~({
+                        "title": "Incremental global passes",
+                        "type": "boolean",
+                        "default": true,
+                        "description": "After the first global pass, only rescan functions that were patched, their callers and callees, and functions sharing patched instructions. Disable to rescan every function on every pass."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.reanalysisScope",
+        R"~({
+                        "title": "Reanalysis scope",
+                        "type": "string",
+                        "default": "function",
+                        "enum": ["function", "view"],
+                        "enumDescriptions": [
+                            "Reanalyze only the patched functions and the functions sharing their patched instructions, and wait for just those.",
+                            "Update and wait for analysis of the entire binary after every batch of patches."
+                        ],
+                        "description": "What to reanalyze after patches are applied before rescanning a function."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.undoGrouping",
+        R"~({
+                        "title": "Undo grouping",
+                        "type": "string",
+                        "default": "pass",
+                        "enum": ["pass", "run"],
+                        "enumDescriptions": [
+                            "Record the patches of each pass as one undoable action.",
+                            "Record the whole run as a single undoable action."
+                        ],
+                        "description": "How patches are grouped in the undo history. Adjacent patched instructions are always written together."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.parallelScanThreshold",
+        R"~({
+                        "title": "Parallel scan threshold",
+                        "type": "number",
+                        "default": 20000,
+                        "description": "Functions with at least this many MLIL instructions have their branches evaluated on all threads when patching all functions. The current function command always splits its function across threads."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.tieredEvaluation",
+        R"~({
+                        "title": "Tiered evaluation",
+                        "type": "boolean",
+                        "default": true,
+                        "description": "Skip functions without conditional branches and resolve branches whose LLIL condition is already constant before generating MLIL. MLIL is only generated, and only evaluated, for the branches that remain."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.streamingMemoryBudget",
+        R"~({
+                        "title": "Streaming memory budget (MB)",
+                        "type": "number",
+                        "default": 0,
+                        "minValue": 0,
+                        "description": "When patching all functions, work through the binary in address-ordered windows sized to roughly this much IL. The solver only keeps references to the MLIL of the current window and drops them before moving on. Binary Ninja frees the IL itself under its own cache policy, so this limits what the solver pins, not the total memory of the process. 0 processes every function together."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.shapeCache",
+        R"~({
+                        "title": "Expression shape cache",
+                        "type": "string",
+                        "default": "templates",
+                        "enum": ["off", "templates", "learn"],
+                        "enumDescriptions": [
+                            "Evaluate every branch condition with dataflow.",
+                            "Decide conditions matching a loaded shape template without dataflow.",
+                            "Also learn shapes from dataflow results. Heuristic: a shape is only trusted after many agreeing sites and no disagreeing one, but a condition that is constant only because of its surroundings can still be learned wrongly."
+                        ],
+                        "description": "Reuse verdicts for branch conditions with the same expression shape (operations, constants and operand structure, with variables renamed), as stamped by obfuscators."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.shapeTemplateFile",
+        R"~({
+                        "title": "Expression shape template file",
+                        "type": "string",
+                        "default": "",
+                        "description": "File of known predicate shapes to preload, as written by the Export Shape Templates command. Templates are trusted as given."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.verdictCache",
+        R"~({
+                        "title": "Cache verdicts in the database",
+                        "type": "boolean",
+                        "default": true,
+                        "description": "Store a fingerprint of every function once it has no opaque predicates left, and skip functions whose fingerprint is unchanged the next time all functions are patched."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.inlineAnalysis",
+        R"~({
+                        "title": "Resolve during analysis",
+                        "type": "boolean",
+                        "default": false,
+                        "description": "Resolve opaque predicates as part of function analysis, right after each function's MLIL is generated. Predicates uncovered by a patch are resolved when the function is reanalysed, without extra global passes. Applies to functions analysed after it is enabled."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.writeReport",
+        R"~({
+                        "title": "Write performance report",
+                        "type": "boolean",
+                        "default": false,
+                        "description": "Write a JSON report with per-phase timings, per-pass results and the slowest functions after each run."
+                        })~");
+    settings->RegisterSetting("nativePredicateSolver.reportDirectory",
+        R"~({
+                        "title": "Performance report directory",
+                        "type": "string",
+                        "default": "",
+                        "description": "Directory for performance reports. Leave empty to write the report next to the analysed file."
+                        })~");
+}
+
+SolverResult SolveFunction(const Ref<BinaryView>& viewRef, const Ref<Function>& func, const SolverOptions& options,
+                           const SolverCallbacks& callbacks, RunStats* stats)
+{
+    BinaryViewBackend backend(viewRef);
+    backend.EnableShapeCache();
+    return SolveFunction(backend, BinaryViewBackend::Wrap(func), options, callbacks, stats);
+}
+
+SolverResult SolveAllFunctions(const Ref<BinaryView>& viewRef, const SolverOptions& options, const SolverCallbacks& callbacks, RunStats* stats)
+{
+    BinaryViewBackend backend(viewRef);
+    backend.EnableShapeCache();
+    SolverResult result = SolveAllFunctions(backend, options, callbacks, stats);
+    backend.LogTierSummary();
+    backend.LogShapeSummary();
+    return result;
+}
+
+SolverResult SolveReachableFunctions(const Ref<BinaryView>& viewRef, const Ref<Function>& root, const SolverOptions& options,
+                                     const SolverCallbacks& callbacks, RunStats* stats)
+{
+    BinaryViewBackend backend(viewRef);
+    backend.EnableShapeCache();
+    SolverResult result = SolveReachableFunctions(backend, BinaryViewBackend::Wrap(root), options, callbacks, stats);
+    backend.LogTierSummary();
+    backend.LogShapeSummary();
+    return result;
+}
+
+bool ScanPatchPlan(const Ref<BinaryView>& viewRef, const SolverOptions& options, const SolverCallbacks& callbacks, std::vector<PlanEntry>& entries)
+{
+    // Nothing is written, so predicates that only appear once earlier ones
+    // are patched are out of reach: this is a single pass
+    BinaryViewBackend backend(viewRef);
+    backend.EnableShapeCache();
+    WorkStealingPool pool(options.threadCount);
+    std::atomic<bool> shouldCancel(false);
+    ScanContext scanContext = {&pool, options.parallelScanThreshold, [&]() { return shouldCancel.load(); }, nullptr};
+
+    auto functions = viewRef->GetAnalysisFunctionList();
+    std::mutex entriesMutex;
+    std::atomic<size_t> processedFunctions(0);
+
+    std::vector<std::pair<uint64_t, WorkStealingPool::Task>> tasks;
+    for (auto& func : functions) {
+        uint64_t extent = std::max(func->GetHighestAddress(), func->GetStart()) - func->GetStart();
+        tasks.emplace_back(extent, [&, func]() {
+            if (shouldCancel.load()) {
+                processedFunctions.fetch_add(1);
+                return;
+            }
+
+            size_t instructionCount = 0;
+            auto patches = ScanFunction(backend, BinaryViewBackend::Wrap(func), scanContext, instructionCount);
+            auto arch = func->GetArchitecture();
+            std::vector<PlanEntry> functionEntries;
+            for (const auto& patch : patches) {
+                PlanEntry entry;
+                if (MakePlanEntry(viewRef, arch, patch, entry))
+                    functionEntries.push_back(entry);
+            }
+            {
+                std::lock_guard<std::mutex> lock(entriesMutex);
+                entries.insert(entries.end(), functionEntries.begin(), functionEntries.end());
+            }
+            processedFunctions.fetch_add(1);
+        });
+    }
+    pool.SubmitBatch(std::move(tasks));
+
+    while (processedFunctions.load() < functions.size() && !shouldCancel.load()) {
+        if (callbacks.isCancelled && callbacks.isCancelled())
+            shouldCancel.store(true);
+        int percentage = (processedFunctions.load() * 100) / functions.size();
+        if (callbacks.setProgressText)
+            callbacks.setProgressText("Scanning " + std::to_string(functions.size()) + " functions (" + std::to_string(percentage) + "%)");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    pool.WaitIdle();
+    backend.LogTierSummary();
+    backend.LogShapeSummary();
+
+    std::sort(entries.begin(), entries.end(), [](const PlanEntry& a, const PlanEntry& b) {
+        return a.address < b.address;
+    });
+    return !shouldCancel.load();
+}
+
+PlanApplyResult ApplyPatchPlan(const Ref<BinaryView>& viewRef, const std::vector<PlanEntry>& entries)
+{
+    PlanApplyResult result;
+    std::map<std::string, Ref<Architecture>> architectures;
+    std::map<std::string, std::vector<SolverPatch>> patches;
+    size_t matched = 0;
+    for (const auto& entry : entries) {
+        auto& arch = architectures[entry.arch];
+        if (!arch)
+            arch = Architecture::GetByName(entry.arch);
+        if (!arch) {
+            result.unknownArchitecture++;
+            continue;
+        }
+        if (HashBytes(viewRef, entry.address, entry.length) != entry.bytesHash) {
+            result.bytesChanged++;
+            continue;
+        }
+        patches[entry.arch].push_back({entry.address, entry.alwaysBranch});
+        matched++;
+    }
+
+    // The whole plan is undone in one step
+    std::string undoId = viewRef->BeginUndoActions();
+    for (const auto& archPatches : patches)
+        result.applied += WritePatches(viewRef, architectures[archPatches.first], archPatches.second);
+    viewRef->CommitUndoActions(undoId);
+    result.writeFailed = matched - result.applied;
+
+    // Every patch is in place before analysis runs once for all of them
+    viewRef->UpdateAnalysis();
+    return result;
+}
+
+void ClearCachedVerdicts(const Ref<BinaryView>& viewRef)
+{
+    viewRef->RemoveMetadata(kVerdictMetadataKey);
+}
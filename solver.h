@@ -0,0 +1,110 @@
+// MIT License
+// 
+// Copyright (c) 2015-2024 Vector 35 Inc
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef NATIVE_PREDICATE_SOLVER_SOLVER_H
+#define NATIVE_PREDICATE_SOLVER_SOLVER_H
+
+#include "library.h"
+#include "core.h"
+#include "stats.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Number of functions listed in the slowest-functions section of a run report
+static constexpr size_t kReportSlowestFunctions = 25;
+
+// Reads the nativePredicateSolver.* settings that apply to viewRef
+SolverOptions GetSolverOptions(const BinaryNinja::Ref<BinaryNinja::BinaryView>& viewRef);
+
+// One patch of a replayable patch plan. The instruction is identified by its
+// address and a hash of its original bytes, so the plan can be checked against
+// a rebuilt binary before anything is written.
+struct PlanEntry {
+    std::string arch;
+    uint64_t address;
+    bool alwaysBranch;
+    size_t length;
+    uint64_t bytesHash;
+};
+
+// What became of the entries of a patch plan. Every entry is counted once.
+struct PlanApplyResult {
+    size_t applied = 0;
+    // The original bytes no longer match the plan
+    size_t bytesChanged = 0;
+    // The plan names an architecture this installation does not have
+    size_t unknownArchitecture = 0;
+    // Matched, but could not be assembled or written
+    size_t writeFailed = 0;
+};
+
+// Registers the nativePredicateSolver.* settings. Called by the plugin on load
+// and by headless hosts that do not load the plugin.
+void RegisterSolverSettings();
+
+// Adds the inline resolution activity to the default function workflow. Must
+// run before any view is analysed; the activity stays idle unless
+// nativePredicateSolver.inlineAnalysis is enabled for the view.
+void RegisterSolverWorkflow();
+
+std::string GetFunctionName(const BinaryNinja::Ref<BinaryNinja::Function>& func);
+
+// Patches one function repeatedly until it has no opaque predicates left or
+// maxPassesPerFunction is reached. Its branches are evaluated on threadCount
+// threads.
+SolverResult SolveFunction(const BinaryNinja::Ref<BinaryNinja::BinaryView>& viewRef, const BinaryNinja::Ref<BinaryNinja::Function>& func,
+                           const SolverOptions& options, const SolverCallbacks& callbacks, RunStats* stats);
+
+// Runs global passes over every function until a pass applies no patches or
+// maxGlobalPasses is reached.
+SolverResult SolveAllFunctions(const BinaryNinja::Ref<BinaryNinja::BinaryView>& viewRef, const SolverOptions& options,
+                               const SolverCallbacks& callbacks, RunStats* stats);
+
+// Runs global passes over func and the functions it reaches through at most
+// reachableDepth calls, following call sites uncovered by patches.
+SolverResult SolveReachableFunctions(const BinaryNinja::Ref<BinaryNinja::BinaryView>& viewRef, const BinaryNinja::Ref<BinaryNinja::Function>& root,
+                                     const SolverOptions& options, const SolverCallbacks& callbacks, RunStats* stats);
+
+// Single detection pass over every function that writes nothing and returns
+// the patches it would apply. Returns false if cancelled.
+bool ScanPatchPlan(const BinaryNinja::Ref<BinaryNinja::BinaryView>& viewRef, const SolverOptions& options, const SolverCallbacks& callbacks,
+                   std::vector<PlanEntry>& entries);
+
+// Applies every plan entry whose original bytes still match. Analysis is
+// updated once, after all of them.
+PlanApplyResult ApplyPatchPlan(const BinaryNinja::Ref<BinaryNinja::BinaryView>& viewRef, const std::vector<PlanEntry>& entries);
+
+bool WritePatchPlan(const std::string& path, const std::vector<PlanEntry>& entries);
+bool ReadPatchPlan(const std::string& path, std::vector<PlanEntry>& entries);
+
+void ClearCachedVerdicts(const BinaryNinja::Ref<BinaryNinja::BinaryView>& viewRef);
+
+// Writes the JSON run report when nativePredicateSolver.writeReport is set. It
+// goes next to the analysed file unless nativePredicateSolver.reportDirectory
+// names another directory.
+void WriteRunReport(const BinaryNinja::Ref<BinaryNinja::BinaryView>& viewRef, const RunStats& stats, const std::string& command,
+                    size_t threadCount, std::chrono::nanoseconds elapsed);
+
+#endif //NATIVE_PREDICATE_SOLVER_SOLVER_H
@@ -0,0 +1,208 @@
+#include "stats.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+static std::atomic<uint64_t> g_nextRunStatsId{1};
+
+// Upper bounds, in microseconds, of the per-function scan time histogram
+static const uint64_t kHistogramBounds[] = {100, 1000, 10000, 100000, 1000000, 10000000};
+static const char* kHistogramLabels[] = {"<0.1ms", "<1ms", "<10ms", "<100ms", "<1s", "<10s", ">=10s"};
+
+const char* GetSolverPhaseName(SolverPhase phase)
+{
+    switch (phase) {
+    case SolverPhase::Prefilter: return "prefilter";
+    case SolverPhase::MediumLevelIL: return "mediumLevelIL";
+    case SolverPhase::ShapeLookup: return "shapeLookup";
+    case SolverPhase::ExprValue: return "exprValue";
+    case SolverPhase::PatchCheck: return "patchCheck";
+    case SolverPhase::CommitWait: return "commitWait";
+    case SolverPhase::PatchWrite: return "patchWrite";
+    case SolverPhase::Reanalysis: return "reanalysis";
+    default: return "unknown";
+    }
+}
+
+std::string EscapeJson(const std::string& text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                result += escaped;
+            } else {
+                result += c;
+            }
+        }
+    }
+    return result;
+}
+
+static double ToMilliseconds(uint64_t nanoseconds)
+{
+    return static_cast<double>(nanoseconds) / 1000000.0;
+}
+
+RunStats::RunStats()
+    : m_id(g_nextRunStatsId.fetch_add(1))
+{
+}
+
+RunStats::ThreadSlot& RunStats::GetSlot()
+{
+    thread_local uint64_t cachedId = 0;
+    thread_local ThreadSlot* cachedSlot = nullptr;
+    if (cachedId == m_id)
+        return *cachedSlot;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_slots.push_back(std::make_unique<ThreadSlot>());
+    cachedId = m_id;
+    cachedSlot = m_slots.back().get();
+    return *cachedSlot;
+}
+
+void RunStats::AddPhaseTime(SolverPhase phase, uint64_t nanoseconds)
+{
+    auto& totals = GetSlot().phases[static_cast<size_t>(phase)];
+    totals.nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    totals.calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RunStats::RecordFunctionScan(uint64_t start, uint64_t nanoseconds, size_t instructions, size_t patches)
+{
+    GetSlot().functions.push_back({start, nanoseconds, instructions, patches});
+}
+
+void RunStats::RecordPass(int pass, size_t functions, size_t patches, uint64_t nanoseconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_passes.push_back({pass, functions, patches, nanoseconds});
+}
+
+std::vector<RunStats::PassRecord> RunStats::GetPasses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_passes;
+}
+
+std::string RunStats::GetSummary() const
+{
+    std::array<uint64_t, static_cast<size_t>(SolverPhase::Count)> totals = {};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& slot : m_slots) {
+            for (size_t i = 0; i < totals.size(); ++i)
+                totals[i] += slot->phases[i].nanoseconds.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::string summary;
+    for (size_t i = 0; i < totals.size(); ++i) {
+        char part[96];
+        snprintf(part, sizeof(part), "%s%s %.0f ms", i ? ", " : "", GetSolverPhaseName(static_cast<SolverPhase>(i)), ToMilliseconds(totals[i]));
+        summary += part;
+    }
+    return summary;
+}
+
+std::string RunStats::ToJson(const std::string& command, size_t threadCount, uint64_t totalNanoseconds, size_t slowestCount,
+                             const std::function<std::string(uint64_t)>& nameForFunction) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Merge the per-thread slots; a function scanned over several passes is
+    // reported once with its times summed
+    std::array<uint64_t, static_cast<size_t>(SolverPhase::Count)> phaseTime = {};
+    std::array<uint64_t, static_cast<size_t>(SolverPhase::Count)> phaseCalls = {};
+    std::unordered_map<uint64_t, FunctionScan> functions;
+    std::unordered_map<uint64_t, size_t> functionScans;
+    for (auto& slot : m_slots) {
+        for (size_t i = 0; i < phaseTime.size(); ++i) {
+            phaseTime[i] += slot->phases[i].nanoseconds.load(std::memory_order_relaxed);
+            phaseCalls[i] += slot->phases[i].calls.load(std::memory_order_relaxed);
+        }
+        for (auto& scan : slot->functions) {
+            auto [it, inserted] = functions.try_emplace(scan.start, scan);
+            if (!inserted) {
+                it->second.nanoseconds += scan.nanoseconds;
+                it->second.instructions = std::max(it->second.instructions, scan.instructions);
+                it->second.patches += scan.patches;
+            }
+            functionScans[scan.start]++;
+        }
+    }
+
+    std::array<uint64_t, std::size(kHistogramLabels)> histogram = {};
+    std::vector<FunctionScan> slowest;
+    slowest.reserve(functions.size());
+    for (auto& [start, scan] : functions) {
+        uint64_t micros = scan.nanoseconds / 1000;
+        size_t bucket = 0;
+        while (bucket < std::size(kHistogramBounds) && micros >= kHistogramBounds[bucket])
+            bucket++;
+        histogram[bucket]++;
+        slowest.push_back(scan);
+    }
+    std::sort(slowest.begin(), slowest.end(), [](const FunctionScan& a, const FunctionScan& b) {
+        return a.nanoseconds > b.nanoseconds;
+    });
+    if (slowest.size() > slowestCount)
+        slowest.resize(slowestCount);
+
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << "{\n";
+    out << "  \"command\": \"" << EscapeJson(command) << "\",\n";
+    out << "  \"threads\": " << threadCount << ",\n";
+    out << "  \"totalMs\": " << ToMilliseconds(totalNanoseconds) << ",\n";
+
+    out << "  \"phases\": {";
+    for (size_t i = 0; i < phaseTime.size(); ++i) {
+        out << (i ? ",\n" : "\n") << "    \"" << GetSolverPhaseName(static_cast<SolverPhase>(i)) << "\": {\"ms\": "
+            << ToMilliseconds(phaseTime[i]) << ", \"calls\": " << phaseCalls[i] << "}";
+    }
+    out << "\n  },\n";
+
+    out << "  \"passes\": [";
+    for (size_t i = 0; i < m_passes.size(); ++i) {
+        const auto& pass = m_passes[i];
+        out << (i ? ",\n" : "\n") << "    {\"pass\": " << pass.pass << ", \"functions\": " << pass.functions
+            << ", \"patches\": " << pass.patches << ", \"ms\": " << ToMilliseconds(pass.nanoseconds) << "}";
+    }
+    out << (m_passes.empty() ? "],\n" : "\n  ],\n");
+
+    out << "  \"functionScanHistogram\": {";
+    for (size_t i = 0; i < histogram.size(); ++i)
+        out << (i ? ", " : "") << "\"" << kHistogramLabels[i] << "\": " << histogram[i];
+    out << "},\n";
+
+    out << "  \"slowestFunctions\": [";
+    for (size_t i = 0; i < slowest.size(); ++i) {
+        const auto& scan = slowest[i];
+        char address[32];
+        snprintf(address, sizeof(address), "0x%" PRIx64, scan.start);
+        out << (i ? ",\n" : "\n") << "    {\"address\": \"" << address << "\"";
+        if (nameForFunction)
+            out << ", \"name\": \"" << EscapeJson(nameForFunction(scan.start)) << "\"";
+        out << ", \"ms\": " << ToMilliseconds(scan.nanoseconds) << ", \"scans\": " << functionScans[scan.start]
+            << ", \"scanCost\": " << scan.instructions << ", \"patches\": " << scan.patches << "}";
+    }
+    out << (slowest.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+    return out.str();
+}
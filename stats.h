@@ -0,0 +1,141 @@
+// MIT License
+//
+// Copyright (c) 2015-2024 Vector 35 Inc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef NATIVE_PREDICATE_SOLVER_STATS_H
+#define NATIVE_PREDICATE_SOLVER_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Phases of a solver run that are timed separately
+enum class SolverPhase {
+    Prefilter,      // Native block and LLIL checks ahead of MLIL
+    MediumLevelIL,  // Function::GetMediumLevelIL
+    ShapeLookup,    // Hashing branch conditions and querying ShapeCache
+    ExprValue,      // MediumLevelILFunction::GetExprValue
+    PatchCheck,     // Is{Always,Never}BranchPatchAvailable
+    CommitWait,     // Scan results queued waiting for the committer
+    PatchWrite,     // AlwaysBranch / ConvertToNop
+    Reanalysis,     // Waiting for analysis after a batch of patches
+    Count
+};
+
+const char* GetSolverPhaseName(SolverPhase phase);
+
+// Escapes text for use inside a JSON string literal
+std::string EscapeJson(const std::string& text);
+
+// Timers and counters for one solver run. Every thread accumulates into its
+// own slot without synchronisation with the other threads; the slots are only
+// merged when a summary or report is produced.
+class RunStats
+{
+public:
+    struct PassRecord {
+        int pass;
+        size_t functions;
+        size_t patches;
+        uint64_t nanoseconds;
+    };
+
+    RunStats();
+
+    void AddPhaseTime(SolverPhase phase, uint64_t nanoseconds);
+    void RecordFunctionScan(uint64_t start, uint64_t nanoseconds, size_t instructions, size_t patches);
+    void RecordPass(int pass, size_t functions, size_t patches, uint64_t nanoseconds);
+
+    // One-line total time per phase, for the log
+    std::string GetSummary() const;
+
+    std::vector<PassRecord> GetPasses() const;
+
+    // Full report: per-phase totals, per-pass results, a histogram of
+    // per-function scan times and the slowest functions. nameForFunction may
+    // be empty, in which case functions are reported by address only.
+    std::string ToJson(const std::string& command, size_t threadCount, uint64_t totalNanoseconds, size_t slowestCount,
+                       const std::function<std::string(uint64_t)>& nameForFunction) const;
+
+private:
+    struct PhaseTotals {
+        std::atomic<uint64_t> nanoseconds{0};
+        std::atomic<uint64_t> calls{0};
+    };
+
+    struct FunctionScan {
+        uint64_t start;
+        uint64_t nanoseconds;
+        // As reported by ScanFunction: MLIL or LLIL instructions, whichever
+        // decided the function, or the backend's cost estimate when it had no
+        // branches. Reported as scanCost since the unit varies.
+        size_t instructions;
+        size_t patches;
+    };
+
+    struct ThreadSlot {
+        std::array<PhaseTotals, static_cast<size_t>(SolverPhase::Count)> phases;
+        // Only written by the owning thread; read once the run has finished
+        std::vector<FunctionScan> functions;
+    };
+
+    ThreadSlot& GetSlot();
+
+    uint64_t m_id;
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadSlot>> m_slots;
+    std::vector<PassRecord> m_passes;
+};
+
+// Adds the lifetime of the timer to a phase. A null stats pointer makes the
+// timer a no-op.
+class PhaseTimer
+{
+public:
+    PhaseTimer(RunStats* stats, SolverPhase phase)
+        : m_stats(stats), m_phase(phase)
+    {
+        if (m_stats)
+            m_start = std::chrono::steady_clock::now();
+    }
+
+    ~PhaseTimer()
+    {
+        if (m_stats)
+            m_stats->AddPhaseTime(m_phase, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    RunStats* m_stats;
+    SolverPhase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif //NATIVE_PREDICATE_SOLVER_STATS_H